@@ -0,0 +1,133 @@
+/**
+ * @file book_view.hpp
+ * @brief This file contains the BookView, a seqlock-published copy of the top of the book for other threads.
+ *
+ * The ladders and get_bids()/get_asks()/best_quote belong to the matching thread. Other threads read the
+ * book through a BookView instead: after each command that changed one of the best BookView::depth levels
+ * of a side, the book copies those levels into the view under a sequence counter. The writer never waits
+ * for readers. A reader copies the view and retries if the counter was odd or moved while it copied, so
+ * any number of readers get a snapshot of one command's result without taking a lock. The payload is kept
+ * in relaxed atomic words so a copy that races a publish is well defined, just discarded.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "market_data.hpp"
+
+struct BookSnapshot {
+    static constexpr size_t depth = 10;
+
+    uint64_t command = 0; // the book's command number this reflects, never goes backwards
+    uint32_t bid_count = 0;
+    uint32_t ask_count = 0;
+    DepthLevel bids[depth]; // best first, bid_count of them valid
+    DepthLevel asks[depth];
+};
+
+// Best bid and ask only, a level with count 0 means that side is empty
+struct TopOfBook {
+    uint64_t command = 0;
+    DepthLevel bid;
+    DepthLevel ask;
+};
+
+class BookView {
+public:
+    static constexpr size_t depth = BookSnapshot::depth;
+
+private:
+    static constexpr size_t words = sizeof(BookSnapshot) / sizeof(uint64_t);
+    static_assert(sizeof(BookSnapshot) % sizeof(uint64_t) == 0, "BookSnapshot should copy as whole words");
+    static constexpr size_t bids_word = offsetof(BookSnapshot, bids) / sizeof(uint64_t);
+    static constexpr size_t asks_word = offsetof(BookSnapshot, asks) / sizeof(uint64_t);
+    static constexpr size_t level_words = sizeof(DepthLevel) / sizeof(uint64_t);
+    static_assert(sizeof(DepthLevel) % sizeof(uint64_t) == 0, "DepthLevel should copy as whole words");
+
+    // A level back from the words it was published as
+    static DepthLevel level_at(const uint64_t* level) {
+        std::array<uint64_t, level_words> raw;
+        std::copy_n(level, level_words, raw.begin());
+        return std::bit_cast<DepthLevel>(raw);
+    }
+
+    // Odd while a publish is under way
+    alignas(64) std::atomic<uint64_t> m_sequence{0};
+    std::atomic<uint64_t> m_words[words] = {};
+
+    // Retries until the copy was not overlapped by a publish. Copies only [first, first + count) of each range.
+    template <size_t N>
+    void read_words(const size_t (&first)[N], const size_t (&count)[N], uint64_t* out) const {
+        for (;;) {
+            const uint64_t before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            for (size_t r = 0; r < N; ++r) {
+                for (size_t i = first[r]; i < first[r] + count[r]; ++i) {
+                    out[i] = m_words[i].load(std::memory_order_relaxed);
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before) {
+                return;
+            }
+        }
+    }
+
+public:
+    BookView() = default;
+    BookView(const BookView&) = delete;
+    BookView& operator=(const BookView&) = delete;
+
+    // Writer side, one thread only
+    void publish(const BookSnapshot& snapshot) {
+        const char* source = reinterpret_cast<const char*>(&snapshot);
+        const uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        // Levels past the counts are stale and never read as valid, so they are not copied
+        auto store = [&](size_t first, size_t count) {
+            for (size_t i = first; i < first + count; ++i) {
+                uint64_t word;
+                std::memcpy(&word, source + i * sizeof(uint64_t), sizeof(word));
+                m_words[i].store(word, std::memory_order_relaxed);
+            }
+        };
+        store(0, bids_word);
+        store(bids_word, snapshot.bid_count * level_words);
+        store(asks_word, snapshot.ask_count * level_words);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Reader side, any thread
+    BookSnapshot read() const {
+        uint64_t copy[words];
+        read_words<1>({0}, {words}, copy);
+        BookSnapshot snapshot;
+        std::memcpy(&snapshot, copy, sizeof(snapshot));
+        return snapshot;
+    }
+
+    // Copies only the header and the best level of each side
+    TopOfBook top() const {
+        uint64_t copy[words];
+        read_words<3>({0, bids_word, asks_word}, {bids_word, level_words, level_words}, copy);
+        TopOfBook top;
+        uint32_t counts[2];
+        std::memcpy(&top.command, copy + offsetof(BookSnapshot, command) / sizeof(uint64_t), sizeof(top.command));
+        std::memcpy(counts, reinterpret_cast<const char*>(copy) + offsetof(BookSnapshot, bid_count), sizeof(counts));
+        if (counts[0] != 0) top.bid = level_at(copy + bids_word);
+        if (counts[1] != 0) top.ask = level_at(copy + asks_word);
+        return top;
+    }
+
+    // Completed publishes so far
+    uint64_t publishes() const { return m_sequence.load(std::memory_order_acquire) / 2; }
+};
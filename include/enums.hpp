@@ -1,5 +1,15 @@
 #pragma once
 
+#include <cstdint>
+
 enum class BookSide {bid, ask};
 enum class Side {buy, sell};
 enum class OrderType {market, limit};
+enum class TimeInForce : uint8_t {gtc, ioc, fok}; // gtc rests a limit remainder, ioc drops it, fok trades all or nothing
+// primary follows the own side's best quote, market the opposite side's, mid the midpoint
+enum class PegType : uint8_t {primary, market, mid};
+// What happens when a taker would trade against a resting order with the same owner. The taker is the newest
+// order, the maker the oldest; decrement shrinks both by the smaller size without a trade.
+enum class StpMode : uint8_t {none, cancel_newest, cancel_oldest, cancel_both, decrement};
+enum class CommandType {new_order, cancel, modify};
+enum class EventType {ack, fill, reject};
@@ -0,0 +1,84 @@
+/**
+ * @file execution.hpp
+ * @brief This file contains the Execution event emitted per match and the sinks that receive them.
+ *
+ * Every time an incoming order trades against a resting one, the book emits one Execution into a sink
+ * chosen at compile time. A resting order that self-trade prevention cancels or cuts back instead is reported
+ * as a SelfTradeCancel, so whoever books exposure from the events sees that quantity leave too. A sink is any
+ * type with on_execution(const Execution&) and on_self_trade_cancel(const SelfTradeCancel&). NullExecutionSink
+ * compiles the events away, and ExecutionBuffer collects them in preallocated storage. Neither makes
+ * virtual calls, and neither allocates until it outgrows its reserve.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+#include "enums.hpp"
+#include "price.hpp"
+
+struct Execution {
+    uint64_t seq = 0;      // per-book execution sequence, starts at 1
+    uint64_t maker_id = 0; // resting order
+    uint64_t taker_id = 0; // incoming order, keeps this id if its remainder rests
+    Price price;           // maker's level
+    int quantity = 0;
+    int maker_remaining = 0; // 0 means the maker left the book
+    int taker_remaining = 0;
+    Side taker_side = Side::buy;
+    uint32_t maker_owner = 0; // read off the maker's hot half, so risk can book the fill without a lookup
+};
+
+// A resting order that self-trade prevention cancelled or shrank instead of trading it against its own owner
+struct SelfTradeCancel {
+    uint64_t maker_id = 0;
+    uint64_t taker_id = 0;
+    int quantity = 0;        // taken off the maker without a fill, iceberg reserve included
+    int maker_remaining = 0; // 0 means the maker left the book
+    BookSide maker_side = BookSide::bid;
+    uint32_t maker_owner = 0;
+};
+
+struct NullExecutionSink {
+    void on_execution(const Execution&) {}
+    void on_self_trade_cancel(const SelfTradeCancel&) {}
+};
+
+class ExecutionBuffer {
+private:
+    std::vector<Execution> m_executions;
+    std::vector<SelfTradeCancel> m_self_trade_cancels;
+
+public:
+    explicit ExecutionBuffer(size_t capacity = 1024) {
+        m_executions.reserve(capacity);
+        m_self_trade_cancels.reserve(capacity / 16);
+    }
+
+    void on_execution(const Execution& execution) { m_executions.push_back(execution); }
+    void on_self_trade_cancel(const SelfTradeCancel& cancel) { m_self_trade_cancels.push_back(cancel); }
+
+    void clear() {
+        m_executions.clear();
+        m_self_trade_cancels.clear();
+    }
+    size_t size() const { return m_executions.size(); }
+    const Execution& operator[](size_t i) const { return m_executions[i]; }
+    std::span<const Execution> executions() const { return m_executions; }
+    // Not part of size() or totals(), nothing traded
+    std::span<const SelfTradeCancel> self_trade_cancels() const { return m_self_trade_cancels; }
+
+    // Units and notional across the buffer, the same pair handle_order returns
+    std::pair<int, Notional> totals() const {
+        int units = 0;
+        Notional value;
+        for (const Execution& execution : m_executions) {
+            units += execution.quantity;
+            value.add(execution.quantity, execution.price);
+        }
+        return {units, value};
+    }
+};
@@ -0,0 +1,134 @@
+/**
+ * @file flat_id_map.hpp
+ * @brief This file contains FlatIdMap, an open-addressing hash map from order id to a small value.
+ *
+ * Keys and values sit inline in one power-of-two array, so a lookup is a mask and a short linear probe over
+ * adjacent slots, and inserts never allocate until the table grows. Id 0 marks an empty slot, which
+ * every book's ids avoid. Probing is Robin Hood, so the table can run 7/8 full and a lookup of an unknown id
+ * still stops after a few slots. Erase shifts the following entries of the probe run back instead of leaving
+ * tombstones, so a table under constant churn never degrades or needs a rebuild. find never inserts, so
+ * lookups of unknown ids leave the table as it was.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+template <typename Value>
+class FlatIdMap {
+private:
+    struct Slot {
+        uint64_t key = 0; // 0 while empty
+        Value value{};
+    };
+
+    static constexpr size_t npos = ~size_t{0};
+
+    std::vector<Slot> m_slots;
+    size_t m_mask = 0;
+    size_t m_size = 0;
+
+    // A book's ids are dense and increasing within its space, so the low bits already spread them evenly and
+    // ids issued together land in neighbouring slots, the way a fill or cancel burst tends to visit them
+    size_t home(uint64_t key) const { return key & m_mask; }
+
+    // How far the entry in slot i sits past its home slot
+    size_t distance(size_t i) const { return (i - home(m_slots[i].key)) & m_mask; }
+
+    void allocate(size_t slots) {
+        m_slots.assign(slots, Slot{});
+        m_mask = slots - 1;
+    }
+
+    // Robin Hood: an entry further from its home takes the slot of one nearer to its own, so every probe run is
+    // ordered by distance and a lookup can stop at the first entry nearer home than it has walked
+    void place(Slot entry) {
+        size_t i = home(entry.key);
+        for (size_t walked = 0;; i = (i + 1) & m_mask, ++walked) {
+            if (m_slots[i].key == 0) {
+                m_slots[i] = entry;
+                return;
+            }
+            const size_t resident = distance(i);
+            if (resident < walked) {
+                std::swap(entry, m_slots[i]);
+                walked = resident;
+            }
+        }
+    }
+
+    size_t slot_of(uint64_t key) const {
+        size_t i = home(key);
+        for (size_t walked = 0;; i = (i + 1) & m_mask, ++walked) {
+            if (m_slots[i].key == key) return key != 0 ? i : npos;
+            if (m_slots[i].key == 0 || distance(i) < walked) return npos;
+        }
+    }
+
+    void grow() {
+        std::vector<Slot> old = std::move(m_slots);
+        allocate(old.size() * 2);
+        for (const Slot& slot : old) {
+            if (slot.key != 0) {
+                place(slot);
+            }
+        }
+    }
+
+public:
+    // Robin Hood probe runs stay short up to 7/8 full. Sized so the expected entries fit under that.
+    explicit FlatIdMap(size_t expected = 0) {
+        size_t slots = 16;
+        while (slots * 7 < expected * 8) {
+            slots *= 2;
+        }
+        allocate(slots);
+    }
+
+    Value* find(uint64_t key) {
+        const size_t i = slot_of(key);
+        return i != npos ? &m_slots[i].value : nullptr;
+    }
+
+    const Value* find(uint64_t key) const {
+        const size_t i = slot_of(key);
+        return i != npos ? &m_slots[i].value : nullptr;
+    }
+
+    // False, leaving the value as it was, if the key is already present. Key 0 is not allowed.
+    bool insert(uint64_t key, const Value& value) {
+        if (slot_of(key) != npos) {
+            return false;
+        }
+        if ((m_size + 1) * 8 > m_slots.size() * 7) {
+            grow();
+        }
+        place(Slot{key, value});
+        m_size++;
+        return true;
+    }
+
+    // Shifts the rest of the probe run back a slot, so no tombstone is left behind
+    bool erase(uint64_t key) {
+        size_t hole = slot_of(key);
+        if (hole == npos) {
+            return false;
+        }
+        for (size_t next = (hole + 1) & m_mask; m_slots[next].key != 0 && distance(next) != 0;
+             next = (next + 1) & m_mask) {
+            m_slots[hole] = m_slots[next];
+            hole = next;
+        }
+        m_slots[hole] = Slot{};
+        m_size--;
+        return true;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t capacity() const { return m_slots.size(); }
+    size_t memory_bytes() const { return m_slots.size() * sizeof(Slot); }
+};
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <chrono>
+#include "price.hpp"
 
 inline uint64_t unix_time() {
     return std::chrono::duration_cast<std::chrono::nanoseconds>(
@@ -15,7 +16,10 @@ inline uint64_t unix_time() {
 
 void print_file_contents(std::string_view file_path);
 
-void print_fill(std::pair<int, double> fill, int quantity, u_int64_t start_time, u_int64_t end_time);
+void print_fill(std::pair<int, Notional> fill, int quantity, u_int64_t start_time, u_int64_t end_time);
+
+// Pins the calling thread to one core, returns false if the OS refused
+bool pin_current_thread(int cpu);
 
 #include <iostream>
 #include <functional>
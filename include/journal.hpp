@@ -0,0 +1,140 @@
+/**
+ * @file journal.hpp
+ * @brief This file contains the append-only binary journal of inbound commands and its reader.
+ *
+ * Every command an Orderbook accepts (add, market, limit, modify, delete) is copied as a fixed 32 byte
+ * JournalRecord into a preallocated memory-mapped file before it is matched, so appending is a plain
+ * store into the page cache. A background thread msyncs the written range every sync_every records or
+ * sync_interval, whichever comes first, which keeps fsync off the matching thread. The file doubles in
+ * size when it fills up and is trimmed to the records written when the journal is closed.
+ *
+ * replay_journal rebuilds a book from a JournalReader. Ids assigned by the replaying book are mapped
+ * from the ids recorded in the journal, so modifies and deletes reach the same orders.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include "enums.hpp"
+#include "price_ladder.hpp"
+
+class Orderbook;
+
+// 0 is left unused so the zero-filled tail of a preallocated file reads as end of journal.
+// An iceberg add takes two records: iceberg (full quantity) then iceberg_peak (peak and the id it produced).
+// So does a stop: stop (Side, quantity, trigger price, OrderType in tif) then stop_price (limit price and id).
+// A peg takes one: BookSide, quantity, offset in ticks as the price's units, PegType in tif and the id.
+// An owner record (the owner in order_id) comes right before the command it belongs to, only when there is one.
+// An stp record (StpMode in side) marks a change of self-trade prevention mode, commands after it match under it.
+enum class JournalOp : uint8_t {add = 1, market, limit, modify, cancel, iceberg, iceberg_peak, stop, stop_price, peg,
+                                owner, stp};
+
+struct JournalRecord {
+    JournalOp op;
+    uint8_t side;         // BookSide for add, Side for market and limit, StpMode for stp
+    uint8_t tif = 0;      // TimeInForce for market and limit, OrderType for stop, PegType for peg
+    uint8_t reserved = 0;
+    int32_t quantity;
+    Price price;
+    uint64_t order_id;    // id the command produced (add, limit, iceberg_peak, stop_price, peg) or targets (modify, cancel)
+    uint64_t timestamp;
+};
+
+static_assert(sizeof(JournalRecord) == 32, "JournalRecord should pack two to a cache line");
+
+// File header, the ladder is recorded so replay converts prices to the same ticks
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    Price tick_size;
+    Price reference_price;
+    uint32_t num_levels;
+    uint8_t reserved[28];
+};
+
+static_assert(sizeof(JournalHeader) == 64, "Records should start on a cache line");
+
+struct JournalConfig {
+    size_t initial_records = 1 << 20;              // preallocated up front, the file doubles when full
+    size_t sync_every = 4096;                      // records written before the flusher is woken, 0 never wakes it early
+    std::chrono::milliseconds sync_interval{10};   // flusher syncs whatever is pending at least this often
+};
+
+class Journal {
+private:
+    int m_fd = -1;
+    std::byte* m_data = nullptr; // header followed by records
+    size_t m_capacity;           // records the current mapping can hold
+    std::atomic<size_t> m_count{0};
+    JournalConfig m_config;
+
+    // The flusher msyncs [m_synced, m_count), m_remap keeps it off a mapping that grow() is replacing
+    std::thread m_flusher;
+    std::mutex m_remap;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    size_t m_synced = 0;
+    size_t m_wake_at;
+
+    JournalRecord* records() { return reinterpret_cast<JournalRecord*>(m_data + sizeof(JournalHeader)); }
+    void map(size_t capacity);
+    void grow();
+    void sync_pending();
+    void run_flusher();
+
+public:
+    // Creates (or truncates) the journal file at path
+    Journal(const std::string& path, const LadderConfig& ladder, const JournalConfig& config = JournalConfig{});
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Called by the owning book's thread only. The record stays writable until the next append,
+    // so the book can fill in the id it assigned.
+    JournalRecord& append(JournalOp op, uint8_t side, int quantity, Price price, uint64_t order_id);
+
+    // Blocks until everything appended so far is on disk
+    void sync();
+
+    size_t size() const { return m_count.load(std::memory_order_relaxed); }
+};
+
+// Read-only view of a journal file, valid records end at the first zeroed slot or the end of the file
+class JournalReader {
+private:
+    int m_fd = -1;
+    const std::byte* m_data = nullptr;
+    size_t m_file_size = 0;
+    size_t m_count = 0;
+    LadderConfig m_ladder;
+
+public:
+    explicit JournalReader(const std::string& path);
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    const LadderConfig& ladder() const { return m_ladder; }
+
+    std::span<const JournalRecord> records() const {
+        return {reinterpret_cast<const JournalRecord*>(m_data + sizeof(JournalHeader)), m_count};
+    }
+};
+
+// Applies the records from first_record on to the book in order, returns the number applied. The book
+// should be built with journal.ladder(), have no journal of its own attached, and be empty unless it was
+// loaded from a snapshot: then pass the snapshot's journal position and last order id, and ids up to that
+// one are taken to be the book's own.
+size_t replay_journal(const JournalReader& journal, Orderbook& book, size_t first_record = 0,
+                      uint64_t preloaded_through = 0);
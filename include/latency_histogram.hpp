@@ -0,0 +1,134 @@
+/**
+ * @file latency_histogram.hpp
+ * @brief This file contains the always-on per-operation latency histograms.
+ *
+ * Latencies are taken with the TSC (rdtsc) and recorded in raw ticks into log-linear buckets:
+ * exact below 64 ticks, then 32 sub-buckets per power of two, so any value is within about 3%.
+ * Every thread records into its own set of histograms, one per operation. A bucket has a single
+ * writer, so a record is a relaxed load and store with no lock and no read-modify-write.
+ * Readers take a LatencySnapshot from any thread by summing every thread's buckets. Counts only
+ * grow, so an interval (or a "reset") is the difference between two snapshots. Ticks are
+ * converted to nanoseconds only when reading, using a one-off calibration against steady_clock.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum class LatencyOp : uint8_t {add, market, limit, modify, cancel};
+constexpr size_t latency_op_count = 5;
+
+inline uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Nanoseconds per TSC tick, measured once on first use (takes about 20ms)
+double tsc_ns_per_tick();
+
+class LatencyHistogram {
+public:
+    static constexpr unsigned sub_bucket_bits = 5;
+    static constexpr size_t linear_limit = size_t{2} << sub_bucket_bits; // values below are exact
+    static constexpr size_t bucket_count = (65 - sub_bucket_bits) << sub_bucket_bits;
+
+    static size_t bucket_of(uint64_t ticks) {
+        if (ticks < linear_limit) {
+            return static_cast<size_t>(ticks);
+        }
+        const unsigned shift = std::bit_width(ticks) - 1 - sub_bucket_bits;
+        return ((shift + 1) << sub_bucket_bits) + (static_cast<size_t>(ticks >> shift) - (size_t{1} << sub_bucket_bits));
+    }
+
+    // Largest value that lands in the bucket
+    static uint64_t bucket_limit(size_t bucket) {
+        if (bucket < linear_limit) {
+            return bucket;
+        }
+        const unsigned shift = static_cast<unsigned>(bucket >> sub_bucket_bits) - 1;
+        const uint64_t mantissa = (bucket & ((size_t{1} << sub_bucket_bits) - 1)) + (uint64_t{1} << sub_bucket_bits);
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    // Only the owning thread records
+    void record(uint64_t ticks) {
+        std::atomic<uint64_t>& count = m_counts[bucket_of(ticks)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    uint64_t count(size_t bucket) const { return m_counts[bucket].load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> m_counts{};
+};
+
+// Counts summed over every recording thread at one point in time
+class LatencySnapshot {
+private:
+    std::array<std::array<uint64_t, LatencyHistogram::bucket_count>, latency_op_count> m_counts{};
+
+    friend class LatencyRecorder;
+
+public:
+    // What was recorded between an earlier snapshot and this one
+    LatencySnapshot since(const LatencySnapshot& earlier) const;
+
+    uint64_t count(LatencyOp op) const;
+
+    // Nanoseconds at quantile q (0.5, 0.99, 0.999...), 0 when nothing was recorded
+    double percentile(LatencyOp op, double q) const;
+    double max(LatencyOp op) const { return percentile(op, 1.0); }
+};
+
+struct ThreadLatency {
+    std::array<LatencyHistogram, latency_op_count> ops;
+};
+
+// Process-wide: each thread records into its own histograms, registered on its first record.
+// Registered histograms are never freed, so what an exited thread recorded still counts.
+class LatencyRecorder {
+private:
+    static inline thread_local ThreadLatency* t_local = nullptr;
+    static ThreadLatency* register_thread();
+
+public:
+    static void record(LatencyOp op, uint64_t ticks) {
+        ThreadLatency* local = t_local;
+        if (local == nullptr) {
+            local = t_local = register_thread();
+        }
+        local->ops[static_cast<size_t>(op)].record(ticks);
+    }
+
+    static LatencySnapshot snapshot();
+};
+
+// Times one operation from construction to destruction when enabled
+class LatencyScope {
+private:
+    uint64_t m_start;
+    LatencyOp m_op;
+    bool m_enabled;
+
+public:
+    LatencyScope(bool enabled, LatencyOp op) : m_start(enabled ? read_tsc() : 0), m_op(op), m_enabled(enabled) {}
+    ~LatencyScope() {
+        if (m_enabled) LatencyRecorder::record(m_op, read_tsc() - m_start);
+    }
+
+    LatencyScope(const LatencyScope&) = delete;
+    LatencyScope& operator=(const LatencyScope&) = delete;
+};
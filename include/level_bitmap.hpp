@@ -0,0 +1,120 @@
+/**
+ * @file level_bitmap.hpp
+ * @brief This file contains the LevelBitmap class used to track non-empty price levels.
+ *
+ * The bitmap is hierarchical: every 64-bit word at one layer is summarised by a single bit
+ * in the layer above, until the top layer fits in one word. Finding the next or previous
+ * occupied level is therefore a handful of count-zero instructions regardless of how
+ * sparse the ladder is.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <bit>
+
+class LevelBitmap {
+private:
+    std::vector<std::vector<uint64_t>> m_layers; // m_layers[0] holds one bit per level
+    size_t m_size;
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit LevelBitmap(size_t size) : m_size(size) {
+        size_t bits = size;
+        do {
+            size_t words = (bits + 63) / 64;
+            m_layers.emplace_back(words, 0);
+            bits = words;
+        } while (bits > 1);
+    }
+
+    size_t size() const { return m_size; }
+
+    size_t memory_bytes() const {
+        size_t bytes = 0;
+        for (const auto& layer : m_layers) {
+            bytes += layer.size() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    bool test(size_t i) const {
+        return (m_layers[0][i >> 6] >> (i & 63)) & 1;
+    }
+
+    bool any() const {
+        return m_layers.back()[0] != 0;
+    }
+
+    void set(size_t i) {
+        for (auto& layer : m_layers) {
+            uint64_t& word = layer[i >> 6];
+            bool was_empty = word == 0;
+            word |= uint64_t{1} << (i & 63);
+            if (!was_empty) break; // summary bits above are already set
+            i >>= 6;
+        }
+    }
+
+    void reset(size_t i) {
+        for (auto& layer : m_layers) {
+            uint64_t& word = layer[i >> 6];
+            word &= ~(uint64_t{1} << (i & 63));
+            if (word != 0) break; // word still occupied, summary stays set
+            i >>= 6;
+        }
+    }
+
+    // Smallest set index >= i, or npos
+    size_t find_next(size_t i) const {
+        if (i >= m_size) return npos;
+        size_t layer = 0;
+        // Climb until a word has a set bit at or after the current position
+        while (true) {
+            uint64_t word = m_layers[layer][i >> 6] & (~uint64_t{0} << (i & 63));
+            if (word != 0) {
+                i = (i & ~size_t{63}) | std::countr_zero(word);
+                break;
+            }
+            if (layer + 1 == m_layers.size()) return npos;
+            i = (i >> 6) + 1;
+            ++layer;
+            if ((i >> 6) >= m_layers[layer].size()) return npos;
+        }
+        // Descend taking the lowest set bit at each layer
+        while (layer > 0) {
+            --layer;
+            i = (i << 6) | std::countr_zero(m_layers[layer][i]);
+        }
+        return i;
+    }
+
+    // Largest set index <= i, or npos
+    size_t find_prev(size_t i) const {
+        if (m_size == 0) return npos;
+        if (i >= m_size) i = m_size - 1;
+        size_t layer = 0;
+        while (true) {
+            uint64_t word = m_layers[layer][i >> 6] & (~uint64_t{0} >> (63 - (i & 63)));
+            if (word != 0) {
+                i = (i & ~size_t{63}) | (63 - std::countl_zero(word));
+                break;
+            }
+            if (layer + 1 == m_layers.size() || (i >> 6) == 0) return npos;
+            i = (i >> 6) - 1;
+            ++layer;
+        }
+        while (layer > 0) {
+            --layer;
+            i = (i << 6) | (63 - std::countl_zero(m_layers[layer][i]));
+        }
+        return i;
+    }
+
+    size_t first() const { return find_next(0); }
+    size_t last() const { return find_prev(m_size - 1); }
+};
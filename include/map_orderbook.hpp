@@ -0,0 +1,71 @@
+/**
+ * @file map_orderbook.hpp
+ * @brief This file contains the declaration of the MapOrderbook class.
+ * 
+ * The MapOrderbook class is the original order book backend, kept as a reference for benchmarks.
+ * It provides functionality to add orders, execute orders, and retrieve the best quote.
+ * The order book is implemented using two maps, one for buy orders (bids) and one for sell orders (asks).
+ * Each map is sorted based on the price of the orders.
+ * The Orderbook class also provides methods to clean up empty keys and print the order book.
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <memory>
+#include "enums.hpp"
+#include "flat_id_map.hpp"
+#include "order.hpp"
+#include "order_id.hpp"
+
+// The original single-struct order layout, every field behind one unique_ptr
+struct MapOrder {
+    uint64_t id;
+    int quantity;
+    BookSide side;
+    Price price;
+    uint64_t timestamp;
+
+    MapOrder(uint64_t i, int q, Price p, BookSide s, uint64_t t = unix_time())
+        : id(i), quantity(q), side(s), price(p), timestamp(t) {}
+};
+
+class MapOrderbook {
+private:
+    std::map<Price, std::deque<std::unique_ptr<MapOrder>>, std::greater<Price>> m_bids;
+    std::map<Price, std::deque<std::unique_ptr<MapOrder>>, std::less<Price>> m_asks;
+    
+    // Where each resting order sits, for modify/delete
+    struct OrderLocation {
+        BookSide side = BookSide::bid;
+        Price price;
+    };
+    FlatIdMap<OrderLocation> m_order_metadata;
+    OrderIds m_ids;
+public:
+    MapOrderbook(bool generate_dummies, size_t expected_orders = 0);
+
+    uint64_t add_order(int qty, Price price, BookSide side);
+    std::pair<int, Notional> handle_order(OrderType type, int order_quantity, Side side, Price price = Price{});
+
+    // Both return false, changing nothing, for ids that are not resting
+    bool modify_order(uint64_t id, int new_qty);
+    bool delete_order(uint64_t id);
+
+    template <typename T>
+    std::pair<int, Notional> fill_order(std::map<Price, std::deque<std::unique_ptr<MapOrder>>, T>& offers,
+                                      const OrderType type, const Side side, int& order_quantity,
+                                      Price price, int& units_transacted, Notional& total_value);
+
+    Price best_quote(BookSide side);
+    size_t order_count() const { return m_order_metadata.size(); }
+
+    const auto& get_bids() { return m_bids; }
+    const auto& get_asks() { return m_asks; }
+
+    template<typename T>
+    void print_leg(std::map<Price, std::deque<std::unique_ptr<MapOrder>>, T>& orders, BookSide side);
+
+    void print();
+};
@@ -0,0 +1,48 @@
+/**
+ * @file market_data.hpp
+ * @brief This file contains the L2 (price level) market data types and the L2Publisher.
+ *
+ * Every price level keeps a running total quantity and order count. When a book has an L2Publisher
+ * attached, each command that changes the book publishes one LevelUpdate per level it changed, carrying
+ * the level's new totals. A consumer can apply these to its own copy of the depth without ever walking
+ * the orders. Orderbook::top_levels copies the best N levels of one side in O(N).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "enums.hpp"
+#include "price.hpp"
+
+struct DepthLevel {
+    Price price;
+    int64_t quantity = 0;
+    uint32_t count = 0;
+};
+
+struct LevelUpdate {
+    uint64_t command = 0; // per-book command number, updates from one command share it
+    BookSide side = BookSide::bid;
+    Price price;
+    int64_t quantity = 0; // 0 once the level is empty
+    uint32_t count = 0;
+};
+
+// Collects level updates in preallocated storage until the consumer drains them
+class L2Publisher {
+private:
+    std::vector<LevelUpdate> m_updates;
+
+public:
+    explicit L2Publisher(size_t capacity = 1024) { m_updates.reserve(capacity); }
+
+    void publish(const LevelUpdate& update) { m_updates.push_back(update); }
+
+    void clear() { m_updates.clear(); }
+    size_t size() const { return m_updates.size(); }
+    const LevelUpdate& operator[](size_t i) const { return m_updates[i]; }
+    std::span<const LevelUpdate> updates() const { return m_updates; }
+};
@@ -0,0 +1,71 @@
+/**
+ * @file matching_engine.hpp
+ * @brief This file contains the MatchingEngine class, which runs many symbols' order books across worker shards.
+ *
+ * Every symbol gets its own Orderbook, addressed by a compact SymbolId. Symbols are spread across N shards
+ * round robin, so the hottest (lowest numbered) symbols land on different workers. Each shard is an OrderGateway:
+ * one matching thread that exclusively owns its books, fed by its own SPSC ring. Matching therefore never takes a
+ * lock; the only shared state is the read-only routing table built at construction. A symbol's book draws order ids
+ * from the id space numbered after the symbol, so ids are unique engine wide without a shared counter.
+ *
+ * Each book maps its ladder lazily, so an idle symbol costs its order pool, id index and level bitmaps rather
+ * than its full ladder. Symbols that trade in different price ranges can each be given their own ladder.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "order_command.hpp"
+#include "order_gateway.hpp"
+#include "orderbook.hpp"
+
+using SymbolId = uint32_t;
+
+struct EngineConfig {
+    size_t num_shards = 1;
+    LadderConfig ladder;             // ladder of every symbol without one of its own
+    std::vector<LadderConfig> symbol_ladders; // by SymbolId, symbols past the end use ladder. Hot symbols prefault here
+                                              // and the rest stay lazy
+    size_t order_capacity = 1 << 12; // preallocated orders per book
+    bool pin_workers = false;        // pin shard i to core (first_cpu + i) % cores
+    int first_cpu = 0;
+    unsigned idle_spins = 1024;
+};
+
+class MatchingEngine {
+private:
+    std::vector<std::unique_ptr<Orderbook>> m_books; // indexed by SymbolId
+    std::vector<std::unique_ptr<OrderGateway>> m_shards;
+    size_t m_num_shards;
+
+public:
+    MatchingEngine(size_t num_symbols, const EngineConfig& config = EngineConfig{});
+
+    MatchingEngine(const MatchingEngine&) = delete;
+    MatchingEngine& operator=(const MatchingEngine&) = delete;
+
+    void start();
+    void stop();
+
+    size_t num_symbols() const { return m_books.size(); }
+    size_t num_shards() const { return m_num_shards; }
+    size_t shard_of(SymbolId symbol) const { return symbol % m_num_shards; }
+
+    // Sum of Orderbook::memory_bytes over every symbol, only safe while the engine is stopped
+    size_t memory_bytes() const;
+
+    // Routes the command to the shard owning cmd.symbol. Call from a single router thread;
+    // false if that shard's ring is full or the symbol is unknown.
+    bool submit(const OrderCommand& cmd) {
+        if (cmd.symbol >= m_books.size()) return false;
+        return m_shards[shard_of(cmd.symbol)]->submit(cmd);
+    }
+
+    // Events of one shard, in the order that shard processed its commands. One consumer thread per shard.
+    bool poll(size_t shard, OrderEvent& event) { return m_shards[shard]->poll(event); }
+
+    // Direct access to a book, only safe while the engine is stopped
+    Orderbook& book(SymbolId symbol) { return *m_books[symbol]; }
+};
@@ -0,0 +1,128 @@
+/**
+ * @file mbo_feed.hpp
+ * @brief This file contains the market-by-order (MBO) feed file format, its reader, generator and replay driver.
+ *
+ * An MBO file is a 64 byte MboHeader followed by header.record_count fixed 32 byte MboRecords, little endian:
+ *
+ *   offset  size  field
+ *        0     1  op         1 add, 2 modify (quantity is the new size), 3 cancel, 4 execute
+ *        1     1  side       BookSide of the resting order (0 bid, 1 ask)
+ *        2     2  reserved
+ *        4     4  quantity   add: size, modify: new size, execute: units traded, cancel: ignored
+ *        8     8  price      int64, the resting order's price in 1/price_scale units (add and execute)
+ *       16     8  order_id   external id, 1..header.max_order_id
+ *       24     8  timestamp  exchange time in nanoseconds, non-decreasing
+ *
+ * External ids are dense: a producer renumbers the venue's order references from 1 up, so replay maps
+ * them onto the book's ids through a flat array instead of a hash table. An execute reports one fill
+ * against one resting order; replay reproduces it with a market order from the other side, which trades
+ * against the same order as long as the replayed book matches the venue's.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "enums.hpp"
+#include "price_ladder.hpp"
+
+class Orderbook;
+
+enum class MboOp : uint8_t {add = 1, modify, cancel, execute};
+
+struct MboRecord {
+    MboOp op;
+    uint8_t side;
+    uint16_t reserved = 0;
+    int32_t quantity;
+    Price price;
+    uint64_t order_id;
+    uint64_t timestamp;
+};
+
+static_assert(sizeof(MboRecord) == 32, "MboRecord should pack two to a cache line");
+
+struct MboHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    Price tick_size; // in price units like the records
+    Price reference_price;
+    uint32_t num_levels;
+    uint32_t reserved0;
+    uint64_t record_count;
+    uint64_t max_order_id; // sizes the id map
+    uint8_t reserved[8];
+};
+
+static_assert(sizeof(MboHeader) == 64, "Records should start on a cache line");
+
+// Read-only view of an MBO file, records are used in place from the mapping
+class MboReader {
+private:
+    int m_fd = -1;
+    const std::byte* m_data = nullptr;
+    size_t m_file_size = 0;
+    MboHeader m_header;
+
+public:
+    explicit MboReader(const std::string& path);
+    ~MboReader();
+
+    MboReader(const MboReader&) = delete;
+    MboReader& operator=(const MboReader&) = delete;
+
+    const MboHeader& header() const { return m_header; }
+    LadderConfig ladder() const { return {m_header.tick_size, m_header.reference_price, m_header.num_levels}; }
+
+    std::span<const MboRecord> records() const {
+        return {reinterpret_cast<const MboRecord*>(m_data + sizeof(MboHeader)), m_header.record_count};
+    }
+};
+
+// External id -> book id, indexed directly by the external id
+class MboIdMap {
+private:
+    std::vector<uint64_t> m_ids;
+
+public:
+    explicit MboIdMap(uint64_t max_order_id) : m_ids(max_order_id + 1, 0) {}
+
+    bool in_range(uint64_t external_id) const { return external_id < m_ids.size(); }
+
+    // 0 for ids that were never added, already removed, or out of range
+    uint64_t get(uint64_t external_id) const { return in_range(external_id) ? m_ids[external_id] : 0; }
+    void set(uint64_t external_id, uint64_t book_id) { m_ids[external_id] = book_id; } // in range only
+};
+
+struct MboReplayConfig {
+    bool paced = false; // follow the recorded timestamps instead of running flat out
+    double speed = 1.0; // paced only, 2.0 replays twice as fast as recorded
+};
+
+struct MboReplayStats {
+    size_t messages = 0;
+    uint64_t elapsed_ns = 0;
+    size_t rejected = 0;   // adds the book refused (price off the ladder, id out of range)
+    size_t mismatches = 0; // modifies/cancels of unknown orders, executes that found less than reported
+    uint64_t max_lag_ns = 0; // paced only, worst delay behind the recorded schedule
+};
+
+// Drives the book with every record in order. The book should be empty and built with feed.ladder().
+MboReplayStats replay_mbo(const MboReader& feed, Orderbook& book, const MboReplayConfig& config = MboReplayConfig{});
+
+struct MboGeneratorStats {
+    size_t records = 0;
+    size_t resting_orders = 0; // in the generating book at the end, a faithful replay ends the same
+    Price best_bid;
+    Price best_ask;
+};
+
+// Writes a synthetic feed of at least num_records messages around a drifting mid, the last sweep may add a
+// few executes past it. Arrivals are Poisson with bursts, add prices fall off as a power law behind the
+// touch, sizes are log-normal, cancels favour recent orders, and every aggressive order is written as the
+// executes it produced against the generating book.
+MboGeneratorStats generate_mbo_feed(const std::string& path, size_t num_records, uint64_t seed = 42);
@@ -1,9 +1,14 @@
 /**
  * @file order.hpp
- * @brief This file contains the declaration of the Order class.
+ * @brief This file contains the declaration of the Order and OrderInfo structs.
  * 
- * The Order class represents an order in an order book. It stores information such as the quantity, price, side, and timestamp of the order.
- * The class provides setters and getters to modify and access the order's properties.
+ * A resting order is split in two. Order holds the hot fields the matching loop touches (links, id, quantity, owner)
+ * and is exactly half a cache line, so walking a price level's FIFO reads two orders per line.
+ * OrderInfo holds the cold fields (price, tick, side, timestamp, iceberg peak and reserve, peg) in a parallel array
+ * owned by the OrderPool. Only cancels and modifies need the tick, so it lives there, leaving the hot half room for
+ * the owner that self-trade prevention compares against every maker. An iceberg's Order::quantity is only its displayed part.
+ * Resting orders are also nodes of an intrusive doubly-linked list, one list per price level, so they can be
+ * unlinked in O(1) once found through the id index.
  */
 
 #pragma once
@@ -11,19 +16,35 @@
 #include <cstdint>
 #include "enums.hpp"
 #include "helpers.hpp"
+#include "price.hpp"
 
-inline uint64_t generate_unique_id() {
-    static uint64_t s_next_id{0};
-    return ++s_next_id;
-}
+struct alignas(32) Order {
+    // Intrusive links within the resting price level
+    Order* next = nullptr;
+    Order* prev = nullptr;
 
-struct Order {
-    uint64_t id;
-    int quantity;
-    BookSide side;
-    double price;
-    uint64_t timestamp;
+    uint64_t id = 0;
+    int quantity = 0;
+    uint32_t owner = 0; // participant for self-trade prevention, 0 for none
+
+    // An order filled inside a batch is only waiting for index cleanup. Its links are dead by then, so a
+    // self-link marks it without touching the cold half.
+    void mark_filled() { prev = this; }
+    bool filled() const { return prev == this; }
+
+    // Never a maker's owner, a taker that must not be checked compares against this
+    static constexpr uint32_t no_owner = UINT32_MAX;
+};
+
+static_assert(sizeof(Order) == 32, "Order should stay half a cache line");
 
-    Order(int q, double p, BookSide s, uint64_t t = unix_time())
-        : id(generate_unique_id()), quantity(q), price(p), side(s), timestamp(t) {}
+struct OrderInfo {
+    Price price;
+    uint64_t timestamp;
+    BookSide side;
+    uint32_t tick = 0; // price level, set once the order is queued
+    int peak = 0;   // iceberg display size, 0 for plain orders
+    int hidden = 0; // iceberg reserve not yet displayed
+    OrderType type = OrderType::limit; // pending stops: what the order becomes once triggered
+    uint32_t peg = 0; // pegged orders: 1 + index of their PegGroup in the book
 };
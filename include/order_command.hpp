@@ -0,0 +1,55 @@
+/**
+ * @file order_command.hpp
+ * @brief This file contains the OrderCommand and OrderEvent structs and the FillSink buffer.
+ *
+ * An OrderCommand is the fixed-size message that carries one request to the book, and an OrderEvent is the
+ * book's answer to it. Batches of commands report their events into a caller-owned FillSink.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "enums.hpp"
+#include "price.hpp"
+
+struct OrderCommand {
+    CommandType type = CommandType::new_order;
+    OrderType order_type = OrderType::limit;
+    TimeInForce tif = TimeInForce::gtc;
+    Side side = Side::buy;
+    int quantity = 0;       // new order size, or the new size for a modify
+    Price price;            // limit price, ignored for market orders
+    uint64_t order_id = 0;  // target of a cancel or modify
+    uint32_t symbol = 0;    // instrument, routes the command to the book that owns it
+    uint32_t owner = 0;     // participant for self-trade prevention, 0 for none
+    uint64_t seq = 0;       // caller's sequence number, echoed back on events
+    uint64_t timestamp = 0; // caller's send time, echoed back on events
+};
+
+struct OrderEvent {
+    EventType type = EventType::ack;
+    int units = 0;          // units transacted by a new order
+    uint64_t order_id = 0;  // resting remainder of a new order, or the cancel/modify target
+    Notional value;         // notional transacted by a new order
+    uint64_t seq = 0;       // echoed from the command
+    uint64_t timestamp = 0; // echoed from the command
+    uint32_t symbol = 0;    // echoed from the command
+};
+
+// Caller-owned buffer of per-command events, reused across batches so it stops allocating once sized
+class FillSink {
+private:
+    std::vector<OrderEvent> m_events;
+
+public:
+    explicit FillSink(size_t capacity = 0) { m_events.reserve(capacity); }
+
+    void push(const OrderEvent& event) { m_events.push_back(event); }
+    void clear() { m_events.clear(); }
+
+    size_t size() const { return m_events.size(); }
+    const OrderEvent& operator[](size_t i) const { return m_events[i]; }
+    std::span<const OrderEvent> events() const { return m_events; }
+};
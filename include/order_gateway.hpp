@@ -0,0 +1,66 @@
+/**
+ * @file order_gateway.hpp
+ * @brief This file contains the OrderGateway class, which runs one or more Orderbooks on its own matching thread.
+ *
+ * A network or parsing thread submits OrderCommands into a lock-free SPSC ring. The matching thread drains
+ * whatever is queued (up to max_batch) and hands each run of same-symbol commands to that book's handle_orders,
+ * then publishes one OrderEvent per command on a second SPSC ring, which the producer (or another single
+ * consumer) polls.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+#include "enums.hpp"
+#include "order_command.hpp"
+#include "orderbook.hpp"
+#include "spsc_ring.hpp"
+
+struct GatewayConfig {
+    int matching_cpu = -1;      // core to pin the matching thread to, -1 leaves it unpinned
+    unsigned idle_spins = 1024; // empty polls before the matching thread yields its core
+    size_t max_batch = 64;      // commands drained from the ring per handle_orders call
+};
+
+class OrderGateway {
+public:
+    static constexpr size_t ring_capacity = 1 << 16;
+    using CommandRing = SpscRing<OrderCommand, ring_capacity>;
+    using EventRing = SpscRing<OrderEvent, ring_capacity>;
+
+private:
+    std::vector<Orderbook*> m_books; // indexed by symbol, null for symbols this gateway does not own
+    GatewayConfig m_config;
+    std::unique_ptr<CommandRing> m_commands;
+    std::unique_ptr<EventRing> m_events;
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+
+    void run();
+    void process_batch(std::span<const OrderCommand> batch, FillSink& sink);
+    void publish(const FillSink& sink);
+
+public:
+    // Single book, served as symbol 0
+    OrderGateway(Orderbook& book, const GatewayConfig& config = GatewayConfig{});
+    OrderGateway(std::vector<Orderbook*> books, const GatewayConfig& config = GatewayConfig{});
+    ~OrderGateway();
+
+    OrderGateway(const OrderGateway&) = delete;
+    OrderGateway& operator=(const OrderGateway&) = delete;
+
+    void start();
+    // Commands already queued are still processed, their events kept while the event ring has room
+    void stop();
+
+    // Producer thread only, false if the command ring is full
+    bool submit(const OrderCommand& cmd) { return m_commands->try_push(cmd); }
+
+    // Consumer thread only, false if no event is ready
+    bool poll(OrderEvent& event) { return m_events->try_pop(event); }
+};
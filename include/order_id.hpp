@@ -0,0 +1,190 @@
+/**
+ * @file order_id.hpp
+ * @brief This file contains the OrderIds generator, which hands out one book's order ids, and the OrderIndex that
+ * finds resting orders by them.
+ *
+ * An id is the book's id space in the top 16 bits and a sequence local to the book in the low 48. Each book owns
+ * its sequence and only the thread matching that book draws from it, so taking an id is an increment: no atomic,
+ * and nothing shared between books or engine shards. An engine gives every book its own space, so ids stay unique
+ * across the whole engine. Ids within a space are dense and increasing. That lets the index be a table of pages
+ * addressed by sequence instead of a hash table: a lookup is a compare, a shift and two loads, and nothing is
+ * hashed. Pages live in a ring indexed by page number, so memory follows the span of live ids rather than every
+ * id ever issued. Pages come from slabs sized from the book's order capacity, and a page whose last order leaves
+ * goes back to the free list. So the index allocates only when more pages hold live orders than the slabs cover,
+ * or when the span from the oldest resting id to the newest outgrows the ring.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "order.hpp"
+#include "order_pool.hpp"
+
+class OrderIds {
+public:
+    static constexpr unsigned sequence_bits = 48;
+    static constexpr uint64_t sequence_mask = (uint64_t{1} << sequence_bits) - 1;
+    static constexpr size_t max_spaces = size_t{1} << (64 - sequence_bits);
+
+    static uint64_t space_of(uint64_t id) { return id >> sequence_bits; }
+    static uint64_t sequence_of(uint64_t id) { return id & sequence_mask; }
+
+private:
+    uint64_t m_base;
+    uint64_t m_last = 0; // sequence of the last id handed out, 0 before the first
+
+public:
+    explicit OrderIds(uint64_t space = 0) : m_base(space << sequence_bits) {
+        if (space >= max_spaces) {
+            throw std::invalid_argument("Order id space out of range");
+        }
+    }
+
+    uint64_t next() { return m_base | ++m_last; }
+
+    uint64_t space() const { return m_base >> sequence_bits; }
+    bool owns(uint64_t id) const { return (id & ~sequence_mask) == m_base; }
+
+    // Last id handed out, written to snapshots. Still carries the space before the first id.
+    uint64_t last() const { return m_base | m_last; }
+
+    // Moves past ids restored from a snapshot so new orders never reuse them
+    void advance(uint64_t last_id) {
+        if (!owns(last_id)) {
+            throw std::invalid_argument("Ids were handed out in a different id space");
+        }
+        if (sequence_of(last_id) > m_last) {
+            m_last = sequence_of(last_id);
+        }
+    }
+};
+
+// Resting orders by id, for ids of one space. Ids from any other space are simply not found.
+class OrderIndex {
+public:
+    static constexpr unsigned page_bits = 8;
+    static constexpr size_t page_size = size_t{1} << page_bits;
+
+private:
+    struct Page {
+        uint64_t number = 0; // sequence >> page_bits
+        size_t live = 0;
+        Order* slots[page_size] = {};
+    };
+
+    uint64_t m_base;
+    // A page sits at its number modulo the ring size. Only pages with a live order are in the ring, so the ring
+    // covers the span between the oldest and newest resting ids and doubles when that span outgrows it.
+    std::vector<Page*> m_ring;
+    // Pages come from slabs like orders do, a free page has every slot null
+    std::vector<std::unique_ptr<Page[]>> m_slabs;
+    std::vector<Page*> m_free;
+    size_t m_slab_pages;
+    size_t m_size = 0;
+    PoolStats m_stats; // in pages
+
+    void add_slab() {
+        m_slabs.push_back(std::make_unique<Page[]>(m_slab_pages));
+        m_free.reserve(m_free.size() + m_slab_pages);
+        for (size_t i = m_slab_pages; i-- > 0;) {
+            m_free.push_back(&m_slabs.back()[i]);
+        }
+        m_stats.capacity += m_slab_pages;
+        m_stats.slabs++;
+    }
+
+    Page* page_of(uint64_t id) const {
+        if ((id & ~OrderIds::sequence_mask) != m_base) {
+            return nullptr;
+        }
+        const uint64_t number = OrderIds::sequence_of(id) >> page_bits;
+        Page* page = m_ring[number & (m_ring.size() - 1)];
+        return page && page->number == number ? page : nullptr;
+    }
+
+    void grow_ring() {
+        std::vector<Page*> ring(m_ring.size() * 2, nullptr);
+        for (Page* page : m_ring) {
+            if (page) {
+                ring[page->number & (ring.size() - 1)] = page;
+            }
+        }
+        m_ring = std::move(ring);
+    }
+
+public:
+    // Orders rest a while, so live ids spread over a few times more pages than they would fill. The first slab
+    // has four pages per page_size expected orders, and the ring twice that many slots.
+    explicit OrderIndex(uint64_t space = 0, size_t expected_orders = 0)
+        : m_base(space << OrderIds::sequence_bits), m_slab_pages(std::max<size_t>(16, expected_orders / page_size * 4)) {
+        size_t ring = 1;
+        while (ring < m_slab_pages * 2) {
+            ring *= 2;
+        }
+        m_ring.assign(ring, nullptr);
+        add_slab();
+    }
+
+    OrderIndex(const OrderIndex&) = delete;
+    OrderIndex& operator=(const OrderIndex&) = delete;
+
+    Order* find(uint64_t id) const {
+        const Page* page = page_of(id);
+        return page ? page->slots[id & (page_size - 1)] : nullptr;
+    }
+
+    // The id must belong to this space and must not be indexed already
+    void insert(uint64_t id, Order* order) {
+        const uint64_t number = OrderIds::sequence_of(id) >> page_bits;
+        Page** slot = &m_ring[number & (m_ring.size() - 1)];
+        while (*slot && (*slot)->number != number) {
+            grow_ring(); // a live page further back holds the slot
+            slot = &m_ring[number & (m_ring.size() - 1)];
+        }
+        if (*slot == nullptr) {
+            if (m_free.empty()) {
+                add_slab();
+            }
+            *slot = m_free.back();
+            m_free.pop_back();
+            (*slot)->number = number;
+            if (++m_stats.in_use > m_stats.high_water_mark) {
+                m_stats.high_water_mark = m_stats.in_use;
+            }
+        }
+        (*slot)->slots[id & (page_size - 1)] = order;
+        (*slot)->live++;
+        m_size++;
+    }
+
+    bool erase(uint64_t id) {
+        Page* page = page_of(id);
+        if (page == nullptr || page->slots[id & (page_size - 1)] == nullptr) {
+            return false;
+        }
+        page->slots[id & (page_size - 1)] = nullptr;
+        m_size--;
+        if (--page->live == 0) {
+            m_ring[page->number & (m_ring.size() - 1)] = nullptr;
+            m_free.push_back(page);
+            m_stats.in_use--;
+        }
+        return true;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // Counted in pages of page_size slots: preallocated, holding a live order, the most at once, slabs allocated
+    const PoolStats& stats() const { return m_stats; }
+
+    // Page slabs plus the ring
+    size_t memory_bytes() const {
+        return m_stats.capacity * sizeof(Page) + m_ring.size() * sizeof(Page*);
+    }
+};
@@ -0,0 +1,101 @@
+/**
+ * @file order_pool.hpp
+ * @brief This file contains the slab pool used to recycle orders.
+ *
+ * OrderPool hands out orders carved from large preallocated slabs and recycles them through an intrusive
+ * free list, so once the pool is warm the order book never calls malloc/free. Each order's cold OrderInfo
+ * sits in a parallel slab at the same slot. If the pool runs dry it grows by another slab, which shows up
+ * in its stats.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "order.hpp"
+
+struct PoolStats {
+    size_t capacity = 0;        // blocks preallocated so far
+    size_t in_use = 0;          // blocks currently handed out
+    size_t high_water_mark = 0; // most blocks ever handed out at once
+    size_t slabs = 0;           // slab allocations made, 1 means the pool never had to grow
+};
+
+// Pool of resting orders, hot Order records and their cold OrderInfo live in parallel slabs at the same slot
+class OrderPool {
+private:
+    struct Slab {
+        std::unique_ptr<Order[]> hot;
+        std::unique_ptr<OrderInfo[]> cold;
+    };
+
+    std::vector<Slab> m_slabs;
+    Order* m_free = nullptr; // threaded through Order::next
+    size_t m_slab_orders;
+    PoolStats m_stats;
+
+    void add_slab() {
+        m_slabs.push_back(Slab{std::make_unique<Order[]>(m_slab_orders),
+                               std::make_unique<OrderInfo[]>(m_slab_orders)});
+        Order* hot = m_slabs.back().hot.get();
+        for (size_t i = m_slab_orders; i-- > 0;) {
+            hot[i].next = m_free;
+            m_free = &hot[i];
+        }
+        m_stats.capacity += m_slab_orders;
+        m_stats.slabs++;
+    }
+
+public:
+    explicit OrderPool(size_t capacity) : m_slab_orders(capacity ? capacity : 1) {
+        add_slab();
+    }
+
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    // Ids come from the owning book's OrderIds, or from a snapshot
+    Order* create_with_id(uint64_t id, int qty, Price price, BookSide side, uint64_t timestamp) {
+        if (m_free == nullptr) {
+            add_slab();
+        }
+        Order* order = m_free;
+        m_free = order->next;
+        if (++m_stats.in_use > m_stats.high_water_mark) {
+            m_stats.high_water_mark = m_stats.in_use;
+        }
+
+        *order = Order{};
+        order->id = id;
+        order->quantity = qty;
+        info(order) = OrderInfo{price, timestamp, side};
+        return order;
+    }
+
+    void destroy(Order* order) {
+        order->next = m_free;
+        m_free = order;
+        m_stats.in_use--;
+    }
+
+    // Cold half of an order, one range check per slab and normally there is only one
+    OrderInfo& info(const Order* order) {
+        for (auto& slab : m_slabs) {
+            const Order* base = slab.hot.get();
+            if (order >= base && order < base + m_slab_orders) {
+                return slab.cold[order - base];
+            }
+        }
+        throw std::invalid_argument("Order does not belong to this pool");
+    }
+
+    const OrderInfo& info(const Order* order) const { return const_cast<OrderPool*>(this)->info(order); }
+
+    const PoolStats& stats() const { return m_stats; }
+
+    // Hot and cold slabs
+    size_t memory_bytes() const { return m_stats.capacity * (sizeof(Order) + sizeof(OrderInfo)); }
+};
@@ -1,51 +1,334 @@
 /**
  * @file orderbook.hpp
  * @brief This file contains the declaration of the Orderbook class.
- * 
+ *
  * The Orderbook class represents an order book, which is a collection of buy and sell orders.
  * It provides functionality to add orders, execute orders, and retrieve the best quote.
- * The order book is implemented using two maps, one for buy orders (bids) and one for sell orders (asks).
- * Each map is sorted based on the price of the orders.
- * The Orderbook class also provides methods to clean up empty keys and print the order book.
+ * The order book is implemented using two price ladders, one for buy orders (bids) and one for sell orders (asks).
+ * Each ladder is a contiguous array of price levels indexed by integer tick, with a bitmap of occupied levels
+ * so the best price is always known without walking a tree. Orders at a level form an intrusive FIFO list and
+ * are indexed by id, so cancels and modifies never scan a queue. Each book draws ids from its own id space, and
+ * the index is a table of pages addressed by them. Orders come from a slab pool sized up front, so the hot paths
+ * do not touch the heap once the book is warm.
+ * The Orderbook class also provides methods to retire empty levels and print the order book.
+ * An optional Journal records every inbound command so the book can be rebuilt with replay_journal,
+ * and load_snapshot restores a book written by write_snapshot without going through add_order.
+ * Each match can also be reported as an Execution (maker, taker, price, quantity) through an ExecutionBuffer.
+ * Levels keep their total quantity and order count, which feed the L2Publisher and top_levels.
+ * Other threads read the book only through a BookView, republished after each command that changes its levels.
+ * With latency tracking on, every add, market, limit, modify and delete is timed into the LatencyRecorder.
+ * Iceberg orders rest with a displayed peak and a hidden reserve that fill_order replenishes in place.
+ * Stop and stop-limit orders wait in a TriggerBook keyed by trigger price until the last trade reaches them.
+ * Pegged orders rest in the ladder like any other and move, a group at a time, when the touch they follow moves.
+ * Orders can carry an owner, and self-trade prevention stops a taker from matching a maker with the same one.
  */
 
 #pragma once
 
-#include <deque>
-#include <map>
-#include <unordered_map>
+#include <functional>
 #include <memory>
+#include <span>
+#include <vector>
+#include "book_view.hpp"
 #include "enums.hpp"
+#include "execution.hpp"
+#include "journal.hpp"
+#include "latency_histogram.hpp"
+#include "market_data.hpp"
 #include "order.hpp"
+#include "order_command.hpp"
+#include "order_id.hpp"
+#include "order_pool.hpp"
+#include "price_ladder.hpp"
+#include "snapshot.hpp"
+#include "trigger_book.hpp"
+
+// Pegged orders sharing a type, side and offset. They always rest together at the group's tick, so a touch move
+// reprices the group once instead of each order.
+struct PegGroup {
+    PegType type;
+    BookSide side;
+    int offset;    // ticks away from the reference, towards the own side
+    size_t tick;   // where the members rest
+    size_t count = 0;
+};
 
 class Orderbook {
 private:
-    std::map<double, std::deque<std::unique_ptr<Order>>, std::greater<double>> m_bids;
-    std::map<double, std::deque<std::unique_ptr<Order>>, std::less<double>> m_asks;
-    
-    // Cache for modify/delete
-    std::unordered_map<uint64_t, std::pair<BookSide, double>> m_order_metadata;
+    LadderConfig m_config;
+    PriceLadder<BookSide::bid> m_bids;
+    PriceLadder<BookSide::ask> m_asks;
+
+    OrderPool m_order_pool;
+
+    // This book's own id sequence, and id -> resting order so modify/delete go straight to the order
+    OrderIds m_ids;
+    OrderIndex m_orders;
+
+    uint64_t m_last_resting_id = 0;
+    uint64_t m_execution_seq = 0;
+
+    // Inside handle_orders, fully filled orders are parked here and leave the index once the batch ends
+    bool m_in_batch = false;
+    std::vector<Order*> m_filled_in_batch;
+
+    Journal* m_journal = nullptr;
+    bool m_track_latency = false;
+    uint32_t m_latency_sample_every = 1;
+    uint32_t m_latency_countdown = 1;
+
+    // Levels the current command changed, published once it completes. A level goes in once per command however
+    // often the command changes it, the bitmaps mark the ones already in.
+    L2Publisher* m_l2 = nullptr;
+    uint64_t m_l2_command = 0;
+    std::vector<std::pair<BookSide, uint32_t>> m_touched;
+    LevelBitmap m_touched_bids;
+    LevelBitmap m_touched_asks;
+
+    // What the BookView holds, the ticks of its levels (bids, asks) and the worst tick it shows per side.
+    // Anything past the edge cannot change the view.
+    BookView* m_view = nullptr;
+    BookSnapshot m_view_snapshot;
+    size_t m_view_ticks[2][BookView::depth] = {};
+    size_t m_view_bid_edge = 0;
+    size_t m_view_ask_edge = LevelBitmap::npos;
+
+    // Resting orders with an iceberg reserve left, while there are none matching never looks for one
+    size_t m_icebergs = 0;
+
+    StpMode m_stp = StpMode::none;
+    uint64_t m_self_trades_prevented = 0;
+    // What fill_order compares each maker's owner against, no_owner when the taker must not be checked
+    uint32_t stp_owner(uint32_t owner) const {
+        return m_stp != StpMode::none && owner != 0 ? owner : Order::no_owner;
+    }
+    // Returns the quantity taken off the maker, 0 when only the taker was cut
+    int prevent_self_trade(PriceLevel& level, Order* maker, int& order_quantity);
+    void drop_maker(PriceLevel& level, Order* maker);
+
+    // Pending stops, created with the first one. The range the current command traded through decides
+    // which of them fire.
+    std::unique_ptr<TriggerBook> m_stops;
+    size_t m_last_trade_tick = LevelBitmap::npos;
+    size_t m_trade_low = LevelBitmap::npos;
+    size_t m_trade_high = 0;
+    TriggerBook& stops() {
+        if (!m_stops) m_stops = std::make_unique<TriggerBook>(m_config, 1 << 10, m_ids.space());
+        return *m_stops;
+    }
+
+    // Groups are never removed, an order's OrderInfo::peg indexes them. While no pegged order rests, commands
+    // skip repricing entirely; otherwise it runs only when the non-pegged touch moved.
+    std::vector<PegGroup> m_peg_groups;
+    size_t m_pegged = 0;
+    size_t m_peg_ref_bid = LevelBitmap::npos;
+    size_t m_peg_ref_ask = LevelBitmap::npos;
+    size_t find_peg_group(PegType type, BookSide side, int offset) const; // npos if there is none yet
+    size_t peg_group(PegType type, BookSide side, int offset);
+    size_t peg_target(const PegGroup& group) const;
+    template <typename Ladder>
+    size_t unpegged_best(const Ladder& ladder, BookSide side) const;
+    void reprice_pegs();
+    void unpeg(Order* order);
+
+    Order* add_order_at_tick(int qty, size_t tick, BookSide side, uint64_t id, uint32_t owner = 0);
+    bool replenish(PriceLevel& level, Order* order, uint64_t& now);
+    void release_filled(Order* order);
+    Order* find_live(uint64_t id);
+
+    void touch(BookSide side, size_t tick) {
+        if (!m_l2 && !m_view) return;
+        LevelBitmap& seen = side == BookSide::bid ? m_touched_bids : m_touched_asks;
+        if (!seen.test(tick)) {
+            seen.set(tick);
+            m_touched.emplace_back(side, static_cast<uint32_t>(tick));
+        }
+    }
+    void publish_levels();
+    void refresh_view(bool rewalk_all = false);
+    template <typename Ladder>
+    static size_t walk_view(const Ladder& ladder, DepthLevel* out, uint32_t& count, size_t* ticks);
+
+    // True for every sample_every-th operation while tracking is on
+    bool sample_latency() {
+        if (!m_track_latency || --m_latency_countdown != 0) return false;
+        m_latency_countdown = m_latency_sample_every;
+        return true;
+    }
+
+    // Matching is templated on the execution sink so the plain entry points compile the events away
+    template <typename Sink>
+    std::pair<int, Notional> submit_order(OrderType type, int order_quantity, Side side, Price price, TimeInForce tif,
+                                        uint32_t owner, Sink& sink);
+    template <typename Sink>
+    std::pair<int, Notional> match_order(OrderType type, int order_quantity, Side side, Price price, TimeInForce tif,
+                                       Sink& sink, uint64_t taker_id = 0, uint32_t owner = 0);
+    // One instantiation per side, order type and time in force, match_order picks it from a table
+    template <Side S, OrderType Type, TimeInForce Tif, typename Sink>
+    std::pair<int, Notional> match_kernel(int order_quantity, Price price, Sink& sink, uint64_t taker_id,
+                                        uint32_t owner);
+    template <typename Sink>
+    void run_stops(Sink& sink);
+    template <OrderType Type, typename Ladder>
+    bool can_fill(const Ladder& offers, int quantity, size_t limit_tick, uint32_t owner) const;
+    template <typename Sink>
+    OrderEvent apply_command(const OrderCommand& cmd, Sink& sink);
+    template <typename Sink>
+    void apply_batch(std::span<const OrderCommand> commands, FillSink& events, Sink& sink);
+
+    JournalRecord* journal(JournalOp op, uint8_t side, int qty, Price price = Price{}, uint64_t id = 0);
+    void journal_owner(uint32_t owner) {
+        if (owner != 0) journal(JournalOp::owner, 0, 0, Price{}, owner);
+    }
 public:
-    Orderbook(bool generate_dummies);
+    static constexpr size_t default_order_capacity = 1 << 16;
+
+    // Ids are drawn from id_space, books that must not share ids (an engine's) each get their own
+    Orderbook(bool generate_dummies, const LadderConfig& config = LadderConfig{},
+              size_t order_capacity = default_order_capacity, uint64_t id_space = 0);
+
+    // The pools and ladders are address-sensitive
+    Orderbook(const Orderbook&) = delete;
+    Orderbook& operator=(const Orderbook&) = delete;
+
+    // Every entry point that creates an order takes an optional owner, 0 for none. Owners must be below
+    // Order::no_owner.
+    uint64_t add_order(int qty, Price price, BookSide side, uint32_t owner = 0);
 
-    void add_order(int qty, double price, BookSide side);
-    std::pair<int, double> handle_order(OrderType type, int order_quantity, Side side, double price = 0);
+    // A stop (type market) or stop-limit (type limit) that waits until the last trade reaches trigger_price: at
+    // or above it for a buy, at or below it for a sell. It then enters the book as a GTC order under the id
+    // returned here. Stops fire after the command whose trade reached them, one at a time, best trigger first
+    // and oldest first within a trigger; a stop's own trades can fire more stops before the next one runs. A stop
+    // the last trade has already reached fires straight away. delete_order cancels a pending stop.
+    uint64_t add_stop(OrderType type, int qty, Side side, Price trigger_price, Price limit_price = Price{},
+                      uint32_t owner = 0);
+    size_t pending_stops() const { return m_stops ? m_stops->size() : 0; }
+    const TriggerBook* trigger_book() const { return m_stops.get(); }
+
+    // Price of the most recent trade, 0 before the first one
+    Price last_trade_price() const {
+        return m_last_trade_tick == LevelBitmap::npos ? Price{} : m_bids.tick_to_price(m_last_trade_tick);
+    }
+    size_t last_trade_tick() const { return m_last_trade_tick; }
+    // Sequence number of the last Execution reported
+    uint64_t execution_seq() const { return m_execution_seq; }
+
+    // Rests qty at a tick that follows the touch: the own side's best for primary, the opposite side's best for
+    // market, the midpoint for mid, each offset_ticks further from the spread. References ignore pegged orders,
+    // and pegs never reach the midpoint from the wrong side, so they cannot cross each other. When the
+    // reference moves, the whole group moves after the command, keeps its ids and its order within the group,
+    // and queues behind orders already at the new level. Throws if the reference side is empty.
+    uint64_t add_peg(PegType type, int qty, BookSide side, int offset_ticks = 0, uint32_t owner = 0);
+    size_t pegged_orders() const { return m_pegged; }
+    const PegGroup& peg_group_of(const OrderInfo& info) const { return m_peg_groups[info.peg - 1]; }
+    size_t peg_group_count() const { return m_peg_groups.size(); }
+
+    // Rests qty showing at most peak at a time. Each time the displayed part fills, the next peak is taken from
+    // the reserve and queued at the back of the level. Level totals, L2 and print show only displayed quantity.
+    uint64_t add_iceberg(int qty, int peak, Price price, BookSide side, uint32_t owner = 0);
+
+    // A GTC limit remainder rests, an IOC one is dropped. A FOK order trades in full or not at all, which is
+    // decided from level totals up front, so a killed FOK leaves the book untouched. Market orders never rest.
+    std::pair<int, Notional> handle_order(OrderType type, int order_quantity, Side side, Price price = Price{},
+                                        TimeInForce tif = TimeInForce::gtc, uint32_t owner = 0);
+
+    // Same, also appending one Execution per match to the buffer
+    std::pair<int, Notional> handle_order(OrderType type, int order_quantity, Side side, Price price,
+                                        ExecutionBuffer& executions, TimeInForce tif = TimeInForce::gtc,
+                                        uint32_t owner = 0);
+
+    // With a mode other than none, a taker never trades with a resting order of its own owner. The check is one
+    // compare per maker on the hot half of the order, so matching costs the same until it fires. A FOK that
+    // would meet its own order is killed up front, except under cancel_oldest, where that order is not counted.
+    // The mode is journaled, so a replay matches under the same rules.
+    void set_self_trade_prevention(StpMode mode) {
+        m_stp = mode;
+        journal(JournalOp::stp, static_cast<uint8_t>(mode), 0);
+    }
+    StpMode self_trade_prevention() const { return m_stp; }
+    uint64_t self_trades_prevented() const { return m_self_trades_prevented; }
+
+    // One command of any type, errors such as an off-ladder price or a killed FOK come back as a reject event
+    OrderEvent handle_command(const OrderCommand& cmd);
+    OrderEvent handle_command(const OrderCommand& cmd, ExecutionBuffer& executions);
+
+    // Processes a burst in arrival order with the same results as one handle_command per entry,
+    // pushing one event per command into the sink
+    void handle_orders(std::span<const OrderCommand> commands, FillSink& sink);
+    void handle_orders(std::span<const OrderCommand> commands, FillSink& sink, ExecutionBuffer& executions);
+
+    // Commands accepted from now on are appended to the journal, null detaches it. Not owned. A self-trade
+    // prevention mode already set is recorded first, so the journal replays under it.
+    void set_journal(Journal* journal) {
+        m_journal = journal;
+        if (m_stp != StpMode::none) {
+            this->journal(JournalOp::stp, static_cast<uint8_t>(m_stp), 0);
+        }
+    }
+
+    // Times operations with the TSC into this thread's LatencyRecorder histograms. Timing only every
+    // sample_every-th operation keeps the cost down where rdtsc is slow, e.g. when a hypervisor traps it.
+    void set_latency_tracking(bool enabled, uint32_t sample_every = 1) {
+        m_track_latency = enabled;
+        m_latency_sample_every = m_latency_countdown = sample_every ? sample_every : 1;
+    }
+
+    // Each command that changes the book publishes the new totals of the levels it changed, null detaches.
+    // Not owned.
+    void set_l2_publisher(L2Publisher* publisher) { m_l2 = publisher; }
+
+    // Publishes the best BookView::depth levels of each side into the view now and after every command that
+    // changes them, for readers on other threads. Null detaches. Not owned.
+    void set_book_view(BookView* view);
+
+    // Copies up to out.size() best levels of one side, best first, returns how many were written
+    size_t top_levels(BookSide side, std::span<DepthLevel> out) const;
+
+    // Journal records already reflected in the book, 0 without a journal
+    uint64_t journal_position() const { return m_journal ? m_journal->size() : 0; }
+
+    // Bulk builds an empty book from a snapshot and moves the id generator past its ids
+    void load_snapshot(const SnapshotReader& snapshot);
+
+    // Id of the remainder the last handle_order call left resting, 0 if it did not rest
+    uint64_t last_resting_id() const { return m_last_resting_id; }
 
     bool modify_order(uint64_t id, int new_qty);
     bool delete_order(uint64_t id);
 
-    template <typename T>
-    std::pair<int, double> fill_order(std::map<double, std::deque<std::unique_ptr<Order>>, T>& offers,
-                                      const OrderType type, const Side side, int& order_quantity,
-                                      double price, int& units_transacted, double& total_value);
+    // Resting order with this id, null if there is none. Side and price are in order_info.
+    const Order* find_order(uint64_t id) const {
+        const Order* order = m_orders.find(id);
+        return order == nullptr || order->filled() ? nullptr : order;
+    }
+
+    template <OrderType Type, typename Ladder, typename Sink>
+    std::pair<int, Notional> fill_order(Ladder& offers, int& order_quantity, size_t limit_tick,
+                                      int& units_transacted, Notional& total_value, uint64_t taker_id,
+                                      uint32_t stp_owner, Sink& sink);
+
+    Price best_quote(BookSide side);
+
+    const auto& get_bids() const { return m_bids; }
+    const auto& get_asks() const { return m_asks; }
+    const LadderConfig& ladder_config() const { return m_config; }
+
+    // Cold fields (price, side, timestamp) of a resting order
+    const OrderInfo& order_info(const Order* order) const { return m_order_pool.info(order); }
+
+    const PoolStats& order_pool_stats() const { return m_order_pool.stats(); }
+    const PoolStats& index_pool_stats() const { return m_orders.stats(); } // in pages of OrderIndex::page_size
 
-    double best_quote(BookSide side);
+    // What the book holds now: level pages its prices have touched, the level bitmaps, the order pool, the id
+    // index and the stop book once there is one. The ladder's width adds only its bitmaps until levels are used.
+    size_t memory_bytes() const;
 
-    const auto& get_bids() { return m_bids; }
-    const auto& get_asks() { return m_asks; }
+    uint64_t id_space() const { return m_ids.space(); }
+    // Last id this book handed out, carries the id space even before the first
+    uint64_t last_order_id() const { return m_ids.last(); }
 
-    template<typename T>
-    void print_leg(std::map<double, std::deque<std::unique_ptr<Order>>, T>& orders, BookSide side);
+    template<typename Ladder>
+    void print_leg(Ladder& orders, BookSide side);
 
     void print();
 };
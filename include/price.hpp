@@ -0,0 +1,87 @@
+/**
+ * @file price.hpp
+ * @brief This file contains Price and Notional, the fixed-point price and traded value the books work in.
+ *
+ * A Price is a whole number of 1/price_scale units in an int64. Every price on a ladder is exact, so converting it
+ * to a tick is integer arithmetic and two spellings of one price compare equal. Decimals become Prices only where
+ * they come in (the REPL, generated flow, test expectations), through the explicit constructor, and go back to
+ * decimals only to be printed or handed to something that wants a double. The conversion rounds to the nearest
+ * unit. A double that is not finite or does not fit becomes Price::invalid(), which lies off every ladder.
+ *
+ * Notional is price units times quantity, summed in 128 bits, so no sweep can overflow it and an average price is
+ * exact integer division.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+// Six decimal places. A double holds every such price up to about 9e9 exactly, so decimals convert without error.
+inline constexpr int64_t price_scale = 1'000'000;
+
+struct Price {
+    int64_t units = 0;
+
+    constexpr Price() = default;
+
+    // Explicit, so a decimal is converted where it comes in and nowhere else
+    explicit Price(double value) : units(from_double(value)) {}
+
+    static constexpr Price from_units(int64_t units) {
+        Price price;
+        price.units = units;
+        return price;
+    }
+
+    static constexpr Price invalid() { return from_units(std::numeric_limits<int64_t>::min()); }
+    constexpr bool valid() const { return units != std::numeric_limits<int64_t>::min(); }
+
+    double to_double() const { return static_cast<double>(units) / price_scale; }
+
+    friend constexpr bool operator==(const Price&, const Price&) = default;
+    friend constexpr auto operator<=>(const Price&, const Price&) = default;
+
+private:
+    static int64_t from_double(double value) {
+        const double scaled = std::round(value * price_scale);
+        // 2^63 itself does not fit, NaN fails the comparison
+        if (!(std::abs(scaled) < 9223372036854775807.0)) {
+            return std::numeric_limits<int64_t>::min();
+        }
+        return static_cast<int64_t>(scaled);
+    }
+};
+
+// As a decimal, following the stream's formatting
+inline std::ostream& operator<<(std::ostream& out, Price price) { return out << price.to_double(); }
+
+struct Notional {
+    __int128 units = 0; // price units times quantity
+
+    constexpr Notional() = default;
+
+    // Decimal value, for comparing against expected amounts
+    explicit Notional(double value) : units(static_cast<__int128>(std::round(value * price_scale))) {}
+
+    void add(int64_t quantity, Price price) { units += static_cast<__int128>(quantity) * price.units; }
+
+    Notional& operator+=(const Notional& other) {
+        units += other.units;
+        return *this;
+    }
+
+    // Value per unit of quantity, to the nearest price unit
+    Price average(int64_t quantity) const {
+        const __int128 rounded = units >= 0 ? (2 * units + quantity) / (2 * quantity)
+                                            : -((-2 * units + quantity) / (2 * quantity));
+        return Price::from_units(static_cast<int64_t>(rounded));
+    }
+
+    double to_double() const { return static_cast<double>(units) / price_scale; }
+
+    friend constexpr bool operator==(const Notional&, const Notional&) = default;
+};
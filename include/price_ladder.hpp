@@ -0,0 +1,349 @@
+/**
+ * @file price_ladder.hpp
+ * @brief This file contains the PriceLevel and PriceLadder classes.
+ *
+ * A PriceLadder stores one side of the book as a contiguous array of price levels indexed by
+ * integer tick. Fixed-point prices are converted to ticks with integer arithmetic using a configurable
+ * tick size and reference price, so a price and its tick map back and forth exactly.
+ * A LevelBitmap tracks which levels are occupied so the next best level is found in O(1).
+ *
+ * The level array is mapped from anonymous memory rather than built up front. An all-zero PriceLevel is an empty
+ * one, so the kernel backs a page of levels only once an order first rests on it, and a wide ladder costs a book
+ * little more than the pages its prices actually visit. The price is a page fault on the matching thread the first
+ * time each page is written, a microsecond or so on an order that would otherwise take a few hundred nanoseconds.
+ * A hot book trades that memory back for latency with LadderConfig::prefault_levels, which has the levels around
+ * prefault_price, or the whole ladder, backed when the ladder is built.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "enums.hpp"
+#include "order.hpp"
+#include "level_bitmap.hpp"
+#include "price.hpp"
+
+struct LadderConfig {
+    Price tick_size{0.01};
+    Price reference_price{}; // price represented by tick 0
+    uint32_t num_levels = 1 << 17;
+    // Levels centred on prefault_price whose pages are backed up front, num_levels or more for all of them.
+    // Only affects memory and first-touch latency, so it is not journaled or kept in snapshots.
+    uint32_t prefault_levels = 0;
+    Price prefault_price{};
+};
+
+// FIFO queue of orders resting at one price, threaded through the orders' own prev/next links.
+// The level does not own its orders. It keeps their total quantity, so quantity changes go through it.
+struct PriceLevel {
+    Order* head = nullptr;
+    Order* tail = nullptr;
+    size_t count = 0;
+    int64_t total_quantity = 0;  // displayed
+    int64_t hidden_quantity = 0; // iceberg reserves, kept by the book
+
+    struct iterator {
+        Order* node;
+        Order& operator*() const { return *node; }
+        Order* operator->() const { return node; }
+        iterator& operator++() { node = node->next; return *this; }
+        bool operator!=(const iterator& other) const { return node != other.node; }
+    };
+
+    bool empty() const { return head == nullptr; }
+    size_t size() const { return count; }
+
+    Order* front() const { return head; }
+
+    // Walks the queue, meant for inspection rather than the hot path
+    const Order* operator[](size_t i) const {
+        Order* node = head;
+        while (i--) node = node->next;
+        return node;
+    }
+
+    iterator begin() const { return iterator{head}; }
+    iterator end() const { return iterator{nullptr}; }
+
+    void push_back(Order* order) {
+        order->prev = tail;
+        order->next = nullptr;
+        if (tail) {
+            tail->next = order;
+        } else {
+            head = order;
+        }
+        tail = order;
+        count++;
+        total_quantity += order->quantity;
+    }
+
+    void set_quantity(Order* order, int quantity) {
+        total_quantity += quantity - order->quantity;
+        order->quantity = quantity;
+    }
+
+    // O(1) removal from anywhere in the queue
+    void unlink(Order* order) {
+        if (order->prev) {
+            order->prev->next = order->next;
+        } else {
+            head = order->next;
+        }
+        if (order->next) {
+            order->next->prev = order->prev;
+        } else {
+            tail = order->prev;
+        }
+        order->prev = order->next = nullptr;
+        count--;
+        total_quantity -= order->quantity;
+    }
+
+    void pop_front() { unlink(head); }
+};
+
+static_assert(std::is_trivially_copyable_v<PriceLevel> && std::is_trivially_destructible_v<PriceLevel>,
+              "Levels are used straight from zeroed pages");
+
+// A ladder's levels in one anonymous mapping, zero filled by the kernel page by page as they are first written
+class LevelArray {
+private:
+    PriceLevel* m_data = nullptr;
+    size_t m_size = 0;
+
+    size_t mapped_bytes() const { return m_size * sizeof(PriceLevel); }
+
+    static size_t page_size() {
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+public:
+    // The prefault window, a first level and a count, is backed before the constructor returns: the whole array
+    // with MAP_POPULATE, anything less by writing a zero into each of its pages
+    explicit LevelArray(size_t size, std::pair<size_t, size_t> prefault = {}) : m_size(size) {
+        const auto [prefault_first, prefault_count] = prefault;
+        if (size == 0) {
+            return;
+        }
+        const int populate = prefault_count >= size ? MAP_POPULATE : 0;
+        void* data = ::mmap(nullptr, mapped_bytes(), PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | populate, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error(std::string("Unable to map price levels: ") + std::strerror(errno));
+        }
+        m_data = static_cast<PriceLevel*>(data);
+        if (populate == 0 && prefault_count != 0) {
+            const size_t page = page_size();
+            const size_t first = prefault_first * sizeof(PriceLevel) / page * page;
+            const size_t last = std::min(prefault_first + prefault_count, size) * sizeof(PriceLevel);
+            for (size_t offset = first; offset < last; offset += page) {
+                reinterpret_cast<volatile char*>(m_data)[offset] = 0;
+            }
+        }
+    }
+
+    ~LevelArray() {
+        if (m_data != nullptr) {
+            ::munmap(m_data, mapped_bytes());
+        }
+    }
+
+    LevelArray(const LevelArray&) = delete;
+    LevelArray& operator=(const LevelArray&) = delete;
+
+    LevelArray(LevelArray&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+    LevelArray& operator=(LevelArray&& other) noexcept {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    size_t size() const { return m_size; }
+    PriceLevel& operator[](size_t i) { return m_data[i]; }
+    const PriceLevel& operator[](size_t i) const { return m_data[i]; }
+
+    // Pages the kernel has backed so far, a page only read maps the shared zero page and is not counted
+    size_t resident_bytes() const {
+        if (m_data == nullptr) {
+            return 0;
+        }
+        const size_t page = page_size();
+        std::vector<unsigned char> pages((mapped_bytes() + page - 1) / page);
+        if (::mincore(m_data, mapped_bytes(), pages.data()) != 0) {
+            return mapped_bytes();
+        }
+        size_t resident = 0;
+        for (unsigned char p : pages) {
+            resident += p & 1;
+        }
+        return resident * page;
+    }
+};
+
+template <BookSide S>
+class PriceLadder {
+private:
+    LevelArray m_levels;
+    LevelBitmap m_occupied;
+    size_t m_best = npos;
+    size_t m_level_count = 0;
+
+    int64_t m_reference; // price units at tick 0
+    int64_t m_tick;      // price units per tick
+
+    // First level and count of the prefault window, clamped to the ladder
+    static std::pair<size_t, size_t> prefault_window(const LadderConfig& config) {
+        const size_t levels = config.num_levels;
+        if (config.prefault_levels >= levels) {
+            return {0, levels};
+        }
+        int64_t offset;
+        if (config.prefault_levels == 0 || config.tick_size.units <= 0 ||
+            __builtin_sub_overflow(config.prefault_price.units, config.reference_price.units, &offset)) {
+            return {0, 0};
+        }
+        const size_t centre = static_cast<size_t>(std::clamp<int64_t>(offset / config.tick_size.units, 0, levels - 1));
+        const size_t half = config.prefault_levels / 2;
+        const size_t first = std::min(centre > half ? centre - half : 0, levels - config.prefault_levels);
+        return {first, config.prefault_levels};
+    }
+
+    // direction 0 rounds to the nearest tick, -1 down and 1 up
+    size_t to_tick(Price price, int direction) const {
+        int64_t offset;
+        if (!price.valid() || __builtin_sub_overflow(price.units, m_reference, &offset)) {
+            throw std::out_of_range("Price outside of ladder range");
+        }
+        int64_t tick = offset / m_tick;
+        const int64_t rest = offset % m_tick;
+        if (direction == 0) {
+            if (rest >= m_tick - rest) {
+                tick++;
+            } else if (-rest >= m_tick + rest) {
+                tick--;
+            }
+        } else if (direction < 0 ? rest < 0 : rest > 0) {
+            tick += direction;
+        }
+        if (tick < 0 || tick >= static_cast<int64_t>(m_levels.size())) {
+            throw std::out_of_range("Price outside of ladder range");
+        }
+        return static_cast<size_t>(tick);
+    }
+
+public:
+    static constexpr size_t npos = LevelBitmap::npos;
+    static constexpr BookSide side = S;
+
+    explicit PriceLadder(const LadderConfig& config)
+        : m_levels(config.num_levels, prefault_window(config)),
+          m_occupied(config.num_levels),
+          m_reference(config.reference_price.units),
+          m_tick(config.tick_size.units) {
+        if (m_tick <= 0 || config.num_levels == 0 || !config.reference_price.valid()) {
+            throw std::invalid_argument("Invalid ladder configuration");
+        }
+    }
+
+    // Is level a better (closer to the touch) than level b on this side?
+    static constexpr bool is_better(size_t a, size_t b) {
+        return S == BookSide::bid ? a > b : a < b;
+    }
+
+    // Can a taker with the given limit trade against the level at this tick?
+    static constexpr bool is_marketable(size_t level_tick, size_t limit_tick) {
+        return S == BookSide::bid ? level_tick >= limit_tick : level_tick <= limit_tick;
+    }
+
+    // Rounds to the nearest tick, halves away from the reference, throws if the price falls outside the ladder
+    size_t price_to_tick(Price price) const { return to_tick(price, 0); }
+
+    // Tick of a limit price on the given side. An off-tick bid rounds down and an off-tick ask up, so an order
+    // never rests or trades beyond its limit.
+    size_t limit_tick(Price price, BookSide limit_side) const {
+        return to_tick(price, limit_side == BookSide::bid ? -1 : 1);
+    }
+
+    Price tick_to_price(size_t tick) const {
+        return Price::from_units(m_reference + static_cast<int64_t>(tick) * m_tick);
+    }
+
+    bool empty() const { return m_best == npos; }
+    size_t size() const { return m_level_count; } // number of non-empty levels
+
+    size_t best_tick() const { return m_best; }
+
+    size_t worst_tick() const {
+        return S == BookSide::bid ? m_occupied.first() : m_occupied.last();
+    }
+
+    // Next occupied tick behind the given one, or npos
+    size_t next_worse(size_t tick) const {
+        if (S == BookSide::bid) {
+            return tick == 0 ? npos : m_occupied.find_prev(tick - 1);
+        }
+        return m_occupied.find_next(tick + 1);
+    }
+
+    // Next occupied tick in front of the given one, or npos
+    size_t next_better(size_t tick) const {
+        if (S == BookSide::ask) {
+            return tick == 0 ? npos : m_occupied.find_prev(tick - 1);
+        }
+        return m_occupied.find_next(tick + 1);
+    }
+
+    // Level pages in use plus the occupancy bitmap
+    size_t memory_bytes() const { return m_levels.resident_bytes() + m_occupied.memory_bytes(); }
+
+    PriceLevel& level(size_t tick) { return m_levels[tick]; }
+    const PriceLevel& level(size_t tick) const { return m_levels[tick]; }
+
+    bool contains(Price price) const {
+        return !m_levels[price_to_tick(price)].empty();
+    }
+
+    // Mirrors std::map::at, throws if no orders rest at this price
+    const PriceLevel& at(Price price) const {
+        const PriceLevel& lvl = m_levels[price_to_tick(price)];
+        if (lvl.empty()) {
+            throw std::out_of_range("No orders at price level");
+        }
+        return lvl;
+    }
+
+    void push_back(size_t tick, Order* order) {
+        PriceLevel& lvl = m_levels[tick];
+        if (lvl.empty()) {
+            m_occupied.set(tick);
+            m_level_count++;
+            if (m_best == npos || is_better(tick, m_best)) {
+                m_best = tick;
+            }
+        }
+        lvl.push_back(order);
+    }
+
+    // Called once a level has been emptied
+    void retire(size_t tick) {
+        m_occupied.reset(tick);
+        m_level_count--;
+        if (tick == m_best) {
+            m_best = next_worse(tick);
+        }
+    }
+};
@@ -0,0 +1,107 @@
+/**
+ * @file risk_gate.hpp
+ * @brief This file contains the RiskGate, which runs pre-trade checks in front of an Orderbook.
+ *
+ * Every new order, modify and cancel for a gated account goes through the gate. A new order must have a positive
+ * size no larger than max_order_quantity, a limit price inside a collar around the opposite best quote (the own
+ * side's when the opposite one is empty), and must keep its account within its limits:
+ *
+ *   open     resting quantity on the order's side, with the new order counted as if it rested
+ *   position net filled quantity, with every resting order on the order's side counted as if it filled
+ *
+ * Accounts are the orders' owners, dense from 1 to max_accounts - 1. Their counters sit in one flat array sized
+ * up front and are updated from the events each command produces: the taker's and, through
+ * Execution::maker_owner, every maker's fills, and the quantity self-trade prevention took off resting orders.
+ * A check is therefore a few compares against one account's cache line. Orders the gate did not see (stops, pegs,
+ * icebergs, another path into the book) are not tracked, so gated accounts should not use them.
+ * Rejections come back as a RiskReject in the result rather than as exceptions.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "enums.hpp"
+#include "execution.hpp"
+#include "order_command.hpp"
+#include "orderbook.hpp"
+
+enum class RiskReject : uint8_t {
+    none,
+    bad_quantity,    // zero or negative
+    too_large,       // above max_order_quantity
+    bad_price,       // not positive, not representable or off the ladder
+    outside_collar,  // too far from the best quote
+    unknown_account, // owner 0 or beyond max_accounts
+    open_limit,
+    position_limit,
+    unknown_order,   // cancel or modify of an order the account does not have resting
+};
+
+struct AccountLimits {
+    int64_t max_open = 1'000'000;     // per side
+    int64_t max_position = 1'000'000; // either way
+};
+
+struct RiskConfig {
+    int max_order_quantity = 100'000;
+    double collar = 0.10; // largest distance of a limit price from the reference, as a fraction of it
+    uint32_t max_accounts = 1 << 12;
+    AccountLimits default_limits;
+};
+
+// Counters and limits of one account, one cache line
+struct alignas(64) AccountRisk {
+    int64_t position = 0;
+    int64_t open_buy = 0;
+    int64_t open_sell = 0;
+    AccountLimits limits;
+};
+
+struct GateResult {
+    RiskReject reject = RiskReject::none;
+    int units = 0;            // transacted by a new order
+    Notional value;           // notional transacted by a new order
+    uint64_t order_id = 0;    // resting remainder of a new order, 0 if it did not rest
+
+    bool accepted() const { return reject == RiskReject::none; }
+};
+
+class RiskGate {
+private:
+    Orderbook& m_book;
+    RiskConfig m_config;
+    std::vector<AccountRisk> m_accounts;
+    ExecutionBuffer m_executions;
+
+    void apply_executions(uint32_t taker);
+
+public:
+    RiskGate(Orderbook& book, const RiskConfig& config = RiskConfig{});
+
+    RiskGate(const RiskGate&) = delete;
+    RiskGate& operator=(const RiskGate&) = delete;
+
+    // Only the checks, without touching the book or the counters
+    RiskReject check(OrderType type, int quantity, Side side, Price price, TimeInForce tif, uint32_t account);
+
+    // Checks, then sends the order to the book and books its fills
+    GateResult submit(OrderType type, int quantity, Side side, Price price, uint32_t account,
+                      TimeInForce tif = TimeInForce::gtc);
+    // Order commands only, cancels and modifies take the calls below
+    GateResult submit(const OrderCommand& cmd) {
+        return submit(cmd.order_type, cmd.quantity, cmd.side, cmd.price, cmd.owner, cmd.tif);
+    }
+
+    // A size increase is checked like new quantity, keeping priority as modify_order always does
+    RiskReject modify(uint32_t account, uint64_t id, int new_quantity);
+    RiskReject cancel(uint32_t account, uint64_t id);
+
+    void set_limits(uint32_t account, const AccountLimits& limits) { m_accounts.at(account).limits = limits; }
+    const AccountRisk& account(uint32_t account) const { return m_accounts.at(account); }
+
+    // Executions of the last submit
+    std::span<const Execution> executions() const { return m_executions.executions(); }
+    // Makers self-trade prevention cut back during the last submit
+    std::span<const SelfTradeCancel> self_trade_cancels() const { return m_executions.self_trade_cancels(); }
+};
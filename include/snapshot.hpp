@@ -0,0 +1,121 @@
+/**
+ * @file snapshot.hpp
+ * @brief This file contains the binary book snapshot format, its reader and the background writer.
+ *
+ * A snapshot is a header followed by every non-empty price level, bids best first and then asks best first.
+ * Each level is a SnapshotLevel followed by its orders in FIFO order. Prices are stored once per level as a
+ * tick, so each order costs 24 bytes (id, timestamp, quantity, owner). The header also carries the id generator
+ * state, the execution sequence and how many journal records the snapshot covers, so a restart loads the snapshot and replays only
+ * the rest of the journal. Iceberg reserves follow the levels as one SnapshotIceberg per iceberg, then pending
+ * stops as one SnapshotStop each in firing order, with the last trade's tick in the header, then one SnapshotPeg
+ * per pegged order. The header also keeps the self-trade prevention mode, which the journal after it assumes.
+ *
+ * snapshot_in_background forks: the child writes the copy-on-write image of the book while the parent keeps
+ * matching, paying only for the fork and for pages it dirties in the meantime.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <sys/types.h>
+#include "enums.hpp"
+#include "price_ladder.hpp"
+
+class Orderbook;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_levels;
+    Price tick_size;
+    Price reference_price;
+    uint64_t last_order_id;    // the book's last id when the snapshot was taken, its top bits are the id space
+    uint64_t execution_seq;    // Execution::seq of the last match, the next one continues from it
+    uint64_t journal_position; // journal records already reflected in the book
+    uint64_t order_count;
+    uint64_t level_count;
+    uint64_t iceberg_count;
+    uint64_t stop_count;
+    uint64_t last_trade_tick; // num_levels or more before the first trade
+    uint64_t peg_count;
+    uint8_t stp_mode; // StpMode
+    uint8_t reserved[7];
+};
+
+#pragma pack(push, 4)
+struct SnapshotLevel {
+    uint32_t tick;
+    uint8_t side; // BookSide
+    uint8_t reserved[3];
+    uint32_t count;
+};
+
+struct SnapshotOrder {
+    uint64_t id;
+    uint64_t timestamp;
+    int32_t quantity;
+    uint32_t owner;
+};
+#pragma pack(pop)
+
+struct SnapshotIceberg {
+    uint64_t id;
+    int32_t peak;
+    int32_t hidden;
+};
+
+struct SnapshotStop {
+    uint64_t id;
+    uint64_t timestamp;
+    Price limit_price; // stop-limit only
+    uint32_t trigger_tick;
+    int32_t quantity;
+    uint8_t side; // Side
+    uint8_t type; // OrderType it becomes
+    uint8_t reserved[2];
+    uint32_t owner;
+};
+
+struct SnapshotPeg {
+    uint64_t id;
+    int32_t offset;
+    uint8_t type; // PegType
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(SnapshotLevel) == 12 && sizeof(SnapshotOrder) == 24, "Snapshot records should stay packed");
+
+// Read-only view of a snapshot file
+class SnapshotReader {
+private:
+    int m_fd = -1;
+    const std::byte* m_data = nullptr;
+    size_t m_file_size = 0;
+    SnapshotHeader m_header;
+
+public:
+    explicit SnapshotReader(const std::string& path);
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    const SnapshotHeader& header() const { return m_header; }
+    LadderConfig ladder() const { return {m_header.tick_size, m_header.reference_price, m_header.num_levels}; }
+
+    // Levels and orders packed after the header, then the iceberg reserves, pending stops and pegs
+    std::span<const std::byte> body() const { return {m_data + sizeof(SnapshotHeader), m_file_size - sizeof(SnapshotHeader)}; }
+};
+
+// Writes the book to path synchronously, through a temporary file renamed into place
+void write_snapshot(const Orderbook& book, const std::string& path);
+
+// Forks a child that writes the snapshot and exits, returns its pid. The book must not be
+// touched by other threads while fork runs.
+pid_t snapshot_in_background(const Orderbook& book, const std::string& path);
+
+// Waits for a background snapshot, true if it was written successfully
+bool wait_for_snapshot(pid_t pid);
@@ -0,0 +1,70 @@
+/**
+ * @file spsc_ring.hpp
+ * @brief This file contains the SpscRing class, a bounded lock-free single-producer/single-consumer queue.
+ *
+ * Head and tail live on their own cache lines, and each side keeps a private copy of the other side's
+ * index so it only touches the shared line when its cached view says the ring looks full (or empty).
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+inline constexpr size_t cache_line_size = 64;
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+private:
+    static constexpr size_t mask = Capacity - 1;
+
+    // Consumer side
+    alignas(cache_line_size) std::atomic<size_t> m_head{0};
+    alignas(cache_line_size) size_t m_cached_tail = 0;
+
+    // Producer side
+    alignas(cache_line_size) std::atomic<size_t> m_tail{0};
+    alignas(cache_line_size) size_t m_cached_head = 0;
+
+    alignas(cache_line_size) std::array<T, Capacity> m_slots;
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer only
+    bool try_push(const T& item) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head == Capacity) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head == Capacity) {
+                return false; // full
+            }
+        }
+        m_slots[tail & mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool try_pop(T& item) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail) {
+                return false; // empty
+            }
+        }
+        item = m_slots[head & mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently, exact when both sides are quiet
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+};
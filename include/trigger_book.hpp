@@ -0,0 +1,147 @@
+/**
+ * @file trigger_book.hpp
+ * @brief This file contains the TriggerBook, which holds pending stop and stop-limit orders until they trigger.
+ *
+ * Pending stops rest in two price ladders keyed by trigger tick instead of limit price. A buy stop fires once
+ * the last trade is at or above its trigger, so buy stops sit in an ask-ordered ladder whose best level is the
+ * lowest trigger; sell stops mirror that in a bid-ordered ladder. Whether a trade fires anything is therefore one
+ * comparison against each ladder's best tick, however many stops are pending, and firing walks only the crossed
+ * range. Within a trigger price stops fire in arrival order. Stops are Orders from their own OrderPool: the
+ * OrderInfo's tick is the trigger, and it also holds the side, the limit price and what the stop becomes (market
+ * or limit) once triggered.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "enums.hpp"
+#include "order.hpp"
+#include "order_id.hpp"
+#include "order_pool.hpp"
+#include "price_ladder.hpp"
+
+struct PendingStop {
+    uint64_t id;
+    Side side;
+    OrderType type;    // market for a stop, limit for a stop-limit
+    int quantity;
+    Price limit_price;
+    size_t trigger_tick;
+    uint64_t timestamp;
+    uint32_t owner = 0;
+};
+
+class TriggerBook {
+private:
+    PriceLadder<BookSide::ask> m_buy_stops;  // lowest trigger first
+    PriceLadder<BookSide::bid> m_sell_stops; // highest trigger first
+    OrderPool m_pool;
+    OrderIndex m_index; // for cancels, off the trade path
+
+    template <typename Ladder>
+    PendingStop pop_best(Ladder& ladder) {
+        const size_t tick = ladder.best_tick();
+        PriceLevel& level = ladder.level(tick);
+        Order* order = level.front();
+        const OrderInfo& info = m_pool.info(order);
+        PendingStop stop{order->id, info.side == BookSide::bid ? Side::buy : Side::sell, info.type,
+                         order->quantity, info.price, tick, info.timestamp, order->owner};
+        level.pop_front();
+        if (level.empty()) {
+            ladder.retire(tick);
+        }
+        m_index.erase(order->id);
+        m_pool.destroy(order);
+        return stop;
+    }
+
+    template <typename Ladder, typename F>
+    static void visit(const Ladder& ladder, const OrderPool& pool, F& f) {
+        for (size_t tick = ladder.best_tick(); tick != Ladder::npos; tick = ladder.next_worse(tick)) {
+            for (const Order& order : ladder.level(tick)) {
+                const OrderInfo& info = pool.info(&order);
+                f(PendingStop{order.id, info.side == BookSide::bid ? Side::buy : Side::sell, info.type,
+                              order.quantity, info.price, tick, info.timestamp, order.owner});
+            }
+        }
+    }
+
+public:
+    // Stop ids come from the book, so the index covers the book's id space
+    TriggerBook(const LadderConfig& config, size_t capacity, uint64_t id_space = 0)
+        : m_buy_stops(config), m_sell_stops(config), m_pool(capacity), m_index(id_space, capacity) {}
+
+    TriggerBook(const TriggerBook&) = delete;
+    TriggerBook& operator=(const TriggerBook&) = delete;
+
+    size_t memory_bytes() const {
+        return m_buy_stops.memory_bytes() + m_sell_stops.memory_bytes() + m_pool.memory_bytes() +
+               m_index.memory_bytes();
+    }
+
+    // Throws if the trigger price falls outside the ladder
+    size_t trigger_tick(Price price) const { return m_buy_stops.price_to_tick(price); }
+
+    void add(const PendingStop& stop) {
+        Order* order = m_pool.create_with_id(stop.id, stop.quantity, stop.limit_price,
+                                             stop.side == Side::buy ? BookSide::bid : BookSide::ask, stop.timestamp);
+        OrderInfo& info = m_pool.info(order);
+        info.type = stop.type;
+        info.tick = static_cast<uint32_t>(stop.trigger_tick);
+        order->owner = stop.owner;
+        if (stop.side == Side::buy) {
+            m_buy_stops.push_back(stop.trigger_tick, order);
+        } else {
+            m_sell_stops.push_back(stop.trigger_tick, order);
+        }
+        m_index.insert(stop.id, order);
+    }
+
+    bool cancel(uint64_t id) {
+        Order* order = m_index.find(id);
+        if (order == nullptr) {
+            return false;
+        }
+        const OrderInfo& info = m_pool.info(order);
+        auto remove = [&](auto& ladder) {
+            PriceLevel& level = ladder.level(info.tick);
+            level.unlink(order);
+            if (level.empty()) {
+                ladder.retire(info.tick);
+            }
+        };
+        if (info.side == BookSide::bid) {
+            remove(m_buy_stops);
+        } else {
+            remove(m_sell_stops);
+        }
+        m_index.erase(id);
+        m_pool.destroy(order);
+        return true;
+    }
+
+    // Removes the first stop that trades between low_tick and high_tick fire: a buy stop at or below the highest,
+    // a sell stop at or above the lowest. Buys before sells, best trigger then arrival order.
+    bool pop_triggered(size_t low_tick, size_t high_tick, PendingStop& out) {
+        if (!m_buy_stops.empty() && m_buy_stops.best_tick() <= high_tick) {
+            out = pop_best(m_buy_stops);
+            return true;
+        }
+        if (!m_sell_stops.empty() && m_sell_stops.best_tick() >= low_tick) {
+            out = pop_best(m_sell_stops);
+            return true;
+        }
+        return false;
+    }
+
+    // Every pending stop, buys then sells, each side in firing order
+    template <typename F>
+    void for_each(F&& f) const {
+        visit(m_buy_stops, m_pool, f);
+        visit(m_sell_stops, m_pool, f);
+    }
+
+    size_t size() const { return m_index.size(); }
+    bool empty() const { return m_index.empty(); }
+};
@@ -1,5 +1,11 @@
 #!/usr/bin/env python3
 
+# Usage: ./plot_dists.py                          histograms of the benchmark_orderbook text dumps
+#        ./plot_dists.py --compare a.json b.json  compare benchmark_suite runs, e.g. from two commits
+
+import json
+import sys
+
 import matplotlib.pyplot as plt
 
 def read_times(filename):
@@ -12,7 +18,53 @@ def read_times(filename):
                 times.append(int(line))
     return times
 
+def load_run(filename):
+    """Read a benchmark_suite JSON file, keyed by profile name."""
+    with open(filename, 'r') as f:
+        run = json.load(f)
+    return run.get("label", filename), {p["name"]: p for p in run["profiles"]}
+
+def compare(filenames):
+    runs = [load_run(f) for f in filenames]
+    profiles = [name for name in runs[0][1] if all(name in r for _, r in runs)]
+    percentiles = ["p50_ns", "p99_ns", "p999_ns", "max_ns"]
+
+    # Table: throughput and percentiles per profile and operation, one row per run
+    for profile in profiles:
+        print(f"=== {profile} ===")
+        for label, r in runs:
+            print(f"  {label:<16} {r[profile]['throughput_median']:>14,.0f} ops/s")
+        ops = [op for op in runs[0][1][profile]["operations"] if all(op in r[profile]["operations"] for _, r in runs)]
+        for op in ops:
+            print(f"  {op:<8} {'':<8}" + "".join(f"{p[:-3]:>10}" for p in percentiles))
+            for label, r in runs:
+                stats = r[profile]["operations"][op]
+                print(f"    {label:<14}" + "".join(f"{stats[p]:>10.0f}" for p in percentiles))
+        print()
+
+    # One subplot per profile: median throughput, then p99 per operation, bars grouped by run
+    fig, axs = plt.subplots(2, len(profiles), figsize=(4 * len(profiles), 8), squeeze=False)
+    width = 0.8 / len(runs)
+    for col, profile in enumerate(profiles):
+        axs[0][col].bar([label for label, _ in runs], [r[profile]["throughput_median"] for _, r in runs])
+        axs[0][col].set_title(f"{profile} (ops/s)")
+        ops = list(runs[0][1][profile]["operations"])
+        for i, (label, r) in enumerate(runs):
+            values = [r[profile]["operations"].get(op, {}).get("p99_ns", 0) for op in ops]
+            axs[1][col].bar([x + i * width for x in range(len(ops))], values, width, label=label)
+        axs[1][col].set_xticks([x + width * (len(runs) - 1) / 2 for x in range(len(ops))])
+        axs[1][col].set_xticklabels(ops)
+        axs[1][col].set_title(f"{profile} p99 (ns)")
+        axs[1][col].legend()
+
+    plt.tight_layout()
+    plt.show()
+
 def main():
+    if len(sys.argv) > 2 and sys.argv[1] == "--compare":
+        compare(sys.argv[2:])
+        return
+
     # Read the data from the text files (times in nanoseconds)
     market_times_ns = read_times("market_times.txt")
     modify_times_ns = read_times("modify_times.txt")
@@ -0,0 +1,133 @@
+/**
+ * @file benchmark_engine.cpp
+ * @brief Multi-symbol throughput of the MatchingEngine as the number of shards grows.
+ *
+ * Symbols are drawn from a Zipf distribution, so a few symbols carry most of the flow as in real markets.
+ * The main thread routes pre-generated commands, a collector thread drains every shard's events, and
+ * throughput is measured from the first submit until the last event is read, followed by the memory the books
+ * hold once the flow has gone through.
+ * Usage: ./benchmark_engine [max_shards] [--pin]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/helpers.hpp"
+#include "../include/matching_engine.hpp"
+
+using namespace std;
+
+// Samples ranks 0..n-1 with P(k) proportional to 1/(k+1)^s
+class ZipfDistribution {
+private:
+    vector<double> m_cdf;
+    std::uniform_real_distribution<double> m_uniform{0.0, 1.0};
+
+public:
+    ZipfDistribution(size_t n, double s) : m_cdf(n) {
+        double sum = 0;
+        for (size_t k = 0; k < n; ++k) {
+            sum += 1.0 / std::pow(static_cast<double>(k + 1), s);
+            m_cdf[k] = sum;
+        }
+        for (double& c : m_cdf) c /= sum;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) {
+        return std::lower_bound(m_cdf.begin(), m_cdf.end(), m_uniform(rng)) - m_cdf.begin();
+    }
+};
+
+int main(int argc, char** argv) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t max_shards = argc > 1 && string(argv[1]) != "--pin" ? std::stoul(argv[1]) : std::max(4u, cores);
+    bool pin = string(argv[argc - 1]) == "--pin";
+
+    const size_t NUM_SYMBOLS = 512;
+    const int NUM_COMMANDS = 1000000;
+
+    EngineConfig config;
+    config.ladder.reference_price = Price(95.0);
+    config.ladder.num_levels = 1024; // 95.00 to 105.23, plenty for flow around 100.00
+    config.order_capacity = 1 << 10;
+    // The head of the Zipf distribution takes most of the flow, so those books are backed up front and the long
+    // tail is left to fault its pages in
+    LadderConfig hot = config.ladder;
+    hot.prefault_levels = hot.num_levels;
+    config.symbol_ladders.assign(16, hot);
+    config.pin_workers = pin;
+    config.first_cpu = 1; // leave core 0 to the router
+
+    std::mt19937 rng(7);
+    ZipfDistribution symbol_dist(NUM_SYMBOLS, 1.0);
+    std::uniform_int_distribution<int> qty_dist(1, 100);
+    std::uniform_int_distribution<int> tick_dist(1, 100);
+
+    // Passive limits and market orders in equal measure, so books neither drain nor grow without bound
+    vector<OrderCommand> commands(NUM_COMMANDS);
+    for (int i = 0; i < NUM_COMMANDS; ++i) {
+        OrderCommand& cmd = commands[i];
+        cmd.seq = i;
+        cmd.symbol = static_cast<uint32_t>(symbol_dist(rng));
+        cmd.side = (rng() & 1) ? Side::buy : Side::sell;
+        cmd.quantity = qty_dist(rng);
+        if (rng() & 1) {
+            cmd.order_type = OrderType::limit;
+            cmd.price = Price(cmd.side == Side::buy ? 100.0 - tick_dist(rng) / 100.0 : 100.0 + tick_dist(rng) / 100.0);
+        } else {
+            cmd.order_type = OrderType::market;
+        }
+    }
+
+    cout << NUM_SYMBOLS << " symbols, Zipf(1.0) flow, " << NUM_COMMANDS << " commands, "
+         << cores << " hardware threads" << (pin ? ", pinned" : "") << "\n";
+
+    double base_rate = 0;
+    for (size_t shards = 1; shards <= max_shards; shards *= 2) {
+        config.num_shards = shards;
+        MatchingEngine engine(NUM_SYMBOLS, config);
+        engine.start();
+
+        std::atomic<bool> done{false};
+        std::thread collector([&] {
+            size_t received = 0;
+            OrderEvent event;
+            while (received < commands.size()) {
+                bool any = false;
+                for (size_t s = 0; s < engine.num_shards(); ++s) {
+                    while (engine.poll(s, event)) {
+                        received++;
+                        any = true;
+                    }
+                }
+                if (!any) std::this_thread::yield();
+            }
+            done = true;
+        });
+
+        if (pin) pin_current_thread(0);
+        uint64_t start_t = unix_time();
+        for (const OrderCommand& cmd : commands) {
+            while (!engine.submit(cmd)) {
+                std::this_thread::yield();
+            }
+        }
+        collector.join();
+        uint64_t end_t = unix_time();
+        engine.stop();
+
+        double rate = commands.size() * 1e9 / (end_t - start_t);
+        if (shards == 1) base_rate = rate;
+        cout << shards << " shard(s): " << static_cast<uint64_t>(rate) << " commands/s, "
+             << rate / base_rate << "x vs 1 shard, " << engine.memory_bytes() / NUM_SYMBOLS / 1024
+             << " KB per book\n";
+    }
+    return 0;
+}
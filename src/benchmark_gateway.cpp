@@ -0,0 +1,116 @@
+/**
+ * @file benchmark_gateway.cpp
+ * @brief End-to-end latency of the OrderGateway, from enqueueing a command to reading its event.
+ *
+ * A producer thread offers a mix of passive limits and market orders at a fixed rate, the gateway's matching
+ * thread processes them, and the main thread polls events. Commands are stamped with their scheduled send time,
+ * so a stalled producer still shows up as latency instead of silently lowering the offered rate.
+ * Usage: ./benchmark_gateway [--pin]
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/helpers.hpp"
+#include "../include/order_gateway.hpp"
+
+using namespace std;
+
+uint64_t percentile(const vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+// Returns the per-command latency samples in nanoseconds, rate 0 means as fast as possible
+vector<uint64_t> run_at_rate(uint64_t rate, int num_commands, bool pin) {
+    LadderConfig ladder;
+    ladder.prefault_levels = ladder.num_levels; // keep first-touch page faults out of the tail
+    Orderbook orderbook(false, ladder, 1 << 17);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> qty_dist(1, 100);
+    std::uniform_int_distribution<int> tick_dist(1, 100);
+
+    // Warm book around 100.00
+    for (int i = 0; i < 10000; ++i) {
+        orderbook.add_order(qty_dist(rng), Price(100.0 - tick_dist(rng) / 100.0), BookSide::bid);
+        orderbook.add_order(qty_dist(rng), Price(100.0 + tick_dist(rng) / 100.0), BookSide::ask);
+    }
+
+    // Pre-generate the flow so the producer loop only paces and enqueues
+    vector<OrderCommand> commands(num_commands);
+    for (int i = 0; i < num_commands; ++i) {
+        OrderCommand& cmd = commands[i];
+        cmd.seq = i;
+        cmd.side = (rng() & 1) ? Side::buy : Side::sell;
+        cmd.quantity = qty_dist(rng);
+        if (rng() & 1) {
+            cmd.order_type = OrderType::limit;
+            cmd.price = Price(cmd.side == Side::buy ? 100.0 - tick_dist(rng) / 100.0 : 100.0 + tick_dist(rng) / 100.0);
+        } else {
+            cmd.order_type = OrderType::market;
+        }
+    }
+
+    GatewayConfig config;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    if (pin) config.matching_cpu = 1 % cores;
+    OrderGateway gateway(orderbook, config);
+    gateway.start();
+
+    std::thread producer([&] {
+        if (pin) pin_current_thread(0);
+        const uint64_t interval = rate ? 1000000000ull / rate : 0;
+        uint64_t next_send = unix_time();
+        for (OrderCommand& cmd : commands) {
+            if (interval) {
+                while (unix_time() < next_send) {}
+                cmd.timestamp = next_send;
+                next_send += interval;
+            } else {
+                cmd.timestamp = unix_time();
+            }
+            while (!gateway.submit(cmd)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    if (pin) pin_current_thread(2 % cores);
+    vector<uint64_t> latencies;
+    latencies.reserve(num_commands);
+    OrderEvent event;
+    while (latencies.size() < static_cast<size_t>(num_commands)) {
+        if (gateway.poll(event)) {
+            latencies.push_back(unix_time() - event.timestamp);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+    gateway.stop();
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+int main(int argc, char** argv) {
+    bool pin = argc > 1 && string(argv[1]) == "--pin";
+    const int NUM_COMMANDS = 200000;
+
+    cout << "Enqueue -> event latency, " << NUM_COMMANDS << " commands per rate"
+         << (pin ? " (threads pinned)" : "") << "\n";
+    for (uint64_t rate : {100000ull, 500000ull, 1000000ull, 0ull}) {
+        vector<uint64_t> latencies = run_at_rate(rate, NUM_COMMANDS, pin);
+        cout << (rate ? to_string(rate) + " msg/s" : string("max rate")) << ": "
+             << "p50 " << percentile(latencies, 50) << " ns, "
+             << "p99 " << percentile(latencies, 99) << " ns, "
+             << "p99.9 " << percentile(latencies, 99.9) << " ns, "
+             << "max " << latencies.back() << " ns\n";
+    }
+    return 0;
+}
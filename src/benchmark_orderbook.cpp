@@ -5,47 +5,80 @@
 #include <chrono>
 #include <algorithm>
 #include <fstream>
+#include <string>
+#include <span>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <ctime>
+#include <array>
+#include <map>
+#include <cmath>
 
 // Include your existing headers
 #include "../include/helpers.hpp"
 #include "../include/enums.hpp"
 #include "../include/order.hpp"
 #include "../include/orderbook.hpp"
+#include "../include/map_orderbook.hpp"
+#include "../include/perf_counter.hpp"
+#include "../include/order_command.hpp"
+#include "../include/latency_histogram.hpp"
+#include "../include/risk_gate.hpp"
+#include "../include/order_id.hpp"
+#include "../include/flat_id_map.hpp"
 
 using namespace std;
 
-int main() {
-    // Create an empty orderbook (no dummy data)
-    Orderbook orderbook(false);
+// Every heap allocation made by this binary goes through here so the alloc mode can count them
+static uint64_t g_heap_allocations = 0;
 
+void* operator new(size_t size) {
+    g_heap_allocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Default ladder with all of its level pages backed up front, so page faults on first touch stay out of the timings
+LadderConfig prefaulted_ladder() {
+    LadderConfig config;
+    config.prefault_levels = config.num_levels;
+    return config;
+}
+
+// Lowest resting bid, used as the anchor for passive buy limits
+double lowest_bid(MapOrderbook& orderbook, double fallback) {
+    return orderbook.get_bids().empty() ? fallback : orderbook.get_bids().rbegin()->first.to_double();
+}
+
+double lowest_bid(Orderbook& orderbook, double fallback) {
+    const auto& bids = orderbook.get_bids();
+    return bids.empty() ? fallback : bids.tick_to_price(bids.worst_tick()).to_double();
+}
+
+// Runs the same scenario against either backend so the two can be compared directly
+template <typename Book>
+void run_benchmark(Book& orderbook, uint64_t seed, bool write_dumps) {
     // Random engine setup
-    std::mt19937 rng(std::random_device{}()); // Mersenne Twister
+    std::mt19937 rng(seed); // Mersenne Twister
     std::uniform_int_distribution<int> qty_dist(100, 1000);
     std::uniform_int_distribution<int> side_dist(0, 1); // 0=buy, 1=sell
 
     // 1) Build 1000 price levels, each with 100 orders
+    // Collect all IDs for modifies/deletes
+    vector<uint64_t> all_ids;
     double start_price = 100.0;
     for (int level = 0; level < 1000; ++level) {
-        double price = start_price + level; // e.g. 100, 101, ...
+        const Price price(start_price + level); // e.g. 100, 101, ...
         for (int j = 0; j < 100; ++j) {
             int quantity = qty_dist(rng);
             BookSide side = (level % 2 == 0) ? BookSide::bid : BookSide::ask;
-            orderbook.add_order(quantity, price, side);
-        }
-    }
-
-    // Collect all IDs for modifies/deletes
-    vector<uint64_t> all_ids;
-    // Bids
-    for (auto& [price, dq] : orderbook.get_bids()) {
-        for (auto& orderPtr : dq) {
-            all_ids.push_back(orderPtr->id);
-        }
-    }
-    // Asks
-    for (auto& [price, dq] : orderbook.get_asks()) {
-        for (auto& orderPtr : dq) {
-            all_ids.push_back(orderPtr->id);
+            all_ids.push_back(orderbook.add_order(quantity, price, side));
         }
     }
 
@@ -56,9 +89,10 @@ int main() {
     // ----------------------------------------------------------------------------------
     // Files to record times for distribution plotting
     // ----------------------------------------------------------------------------------
-    ofstream marketTimesFile("market_times.txt");
-    ofstream modifyTimesFile("modify_times.txt");
-    ofstream deleteTimesFile("delete_times.txt");
+    // Dumps go to /dev/null when comparing backends so one run does not overwrite the other
+    ofstream marketTimesFile(write_dumps ? "market_times.txt" : "/dev/null");
+    ofstream modifyTimesFile(write_dumps ? "modify_times.txt" : "/dev/null");
+    ofstream deleteTimesFile(write_dumps ? "delete_times.txt" : "/dev/null");
 
     // ----------------------------------------------------------------------------------
     // 2) Random Market Orders
@@ -158,7 +192,7 @@ int main() {
     // 5) Random Limit Orders (near best bid/ask, but not improving them)
     // ----------------------------------------------------------------------------------
     const int NUM_LIMIT_ORDERS = 1000;
-    ofstream limitTimesFile("limit_times.txt");
+    ofstream limitTimesFile(write_dumps ? "limit_times.txt" : "/dev/null");
     uint64_t total_limit_ns = 0;
 
     // Normal distribution for price offset (adjust standard deviation as needed)
@@ -173,25 +207,24 @@ int main() {
         if (side == Side::buy) {
             // For a buy, we do not want a price better than the current best bid.
             // Assume bids are stored in a way where the best bid is the highest price.
-            double best_bid = orderbook.get_bids().empty() 
-                ? start_price 
-                : orderbook.get_bids().rbegin()->first;
+            double best_bid = lowest_bid(orderbook, start_price);
             // Generate a non-negative offset and subtract it from best_bid.
             double offset = std::abs(price_offset(rng));
             limit_price = best_bid - offset;
         } else { // Side::sell
             // For a sell, we do not want a price better than the current best ask.
             // Assume asks are stored such that the best ask is the lowest price.
-            double best_ask = orderbook.get_asks().empty() 
-                ? start_price 
-                : orderbook.get_asks().begin()->first;
+            double best_ask = orderbook.get_asks().empty()
+                ? start_price
+                : orderbook.best_quote(BookSide::ask).to_double();
             double offset = std::abs(price_offset(rng));
             limit_price = best_ask + offset;
         }
 
+        const Price limit(limit_price);
         uint64_t start_t = unix_time();
         // Assumes handle_order can take a limit order with a specified price.
-        orderbook.handle_order(OrderType::limit, qty, side, limit_price);
+        orderbook.handle_order(OrderType::limit, qty, side, limit);
         uint64_t end_t = unix_time();
 
         uint64_t duration = end_t - start_t;
@@ -202,6 +235,926 @@ int main() {
     cout << "Average time for " << NUM_LIMIT_ORDERS << " limit orders: "
          << avg_limit_ns << " ns\n";
     limitTimesFile.close();
+}
+
+// Mixed add/cancel/modify/trade flow around a warm book, counting heap allocations made inside book calls
+template <typename Book>
+uint64_t count_steady_state_allocations(Book& orderbook, uint64_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> qty_dist(1, 100);
+    std::uniform_int_distribution<int> tick_dist(1, 500);
+    std::uniform_int_distribution<int> action_dist(0, 99);
+
+    const double mid = 100.0;
+    vector<uint64_t> live_ids;
+    live_ids.reserve(1 << 20);
+
+    // Warm up: 20k resting orders on each side of the mid
+    for (int i = 0; i < 20000; ++i) {
+        live_ids.push_back(orderbook.add_order(qty_dist(rng), Price(mid - tick_dist(rng) / 100.0), BookSide::bid));
+        live_ids.push_back(orderbook.add_order(qty_dist(rng), Price(mid + tick_dist(rng) / 100.0), BookSide::ask));
+    }
+
+    const int NUM_OPS = 500000;
+    uint64_t book_allocations = 0;
+    for (int i = 0; i < NUM_OPS; ++i) {
+        int action = action_dist(rng);
+        bool buy = action & 1;
+        int qty = qty_dist(rng);
+
+        if (action < 40) { // passive add, never crosses since bids stay below the mid and asks above
+            const Price price(buy ? mid - tick_dist(rng) / 100.0 : mid + tick_dist(rng) / 100.0);
+            uint64_t before = g_heap_allocations;
+            uint64_t id = orderbook.add_order(qty, price, buy ? BookSide::bid : BookSide::ask);
+            book_allocations += g_heap_allocations - before;
+            live_ids.push_back(id);
+        } else if (action < 70 && !live_ids.empty()) { // cancel, may hit an id that already traded
+            size_t idx = rng() % live_ids.size();
+            uint64_t id = live_ids[idx];
+            live_ids[idx] = live_ids.back();
+            live_ids.pop_back();
+            uint64_t before = g_heap_allocations;
+            orderbook.delete_order(id);
+            book_allocations += g_heap_allocations - before;
+        } else if (action < 80 && !live_ids.empty()) { // modify
+            uint64_t id = live_ids[rng() % live_ids.size()];
+            uint64_t before = g_heap_allocations;
+            orderbook.modify_order(id, qty);
+            book_allocations += g_heap_allocations - before;
+        } else { // trade
+            uint64_t before = g_heap_allocations;
+            orderbook.handle_order(OrderType::market, qty, buy ? Side::buy : Side::sell);
+            book_allocations += g_heap_allocations - before;
+        }
+    }
+    return book_allocations;
+}
+
+void print_pool_stats(const char* name, const PoolStats& stats) {
+    cout << name << " pool: capacity " << stats.capacity << ", high water mark " << stats.high_water_mark
+         << ", in use " << stats.in_use << ", slabs " << stats.slabs << "\n";
+}
+
+// Sweeps a deep ask side with market buys and reports cache misses per matched order.
+// Interleaved building adds orders round robin across levels so FIFO neighbours are not memory neighbours.
+template <typename Book>
+void measure_match_cache_misses(Book& orderbook, const char* name, bool interleaved, uint64_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> qty_dist(1, 100);
+    const int LEVELS = 200;
+    const int DEPTH = 500;
+
+    for (int i = 0; i < LEVELS * DEPTH; ++i) {
+        int level = interleaved ? i % LEVELS : i / DEPTH;
+        orderbook.add_order(qty_dist(rng), Price(100.0 + level / 100.0), BookSide::ask);
+    }
+
+    PerfCounter cache_misses = PerfCounter::cache_misses();
+    PerfCounter l1d_misses = PerfCounter::l1d_read_misses();
+    const uint64_t matched_orders = LEVELS * DEPTH;
+
+    cache_misses.start();
+    l1d_misses.start();
+    uint64_t start_t = unix_time();
+    while (!orderbook.get_asks().empty()) {
+        orderbook.handle_order(OrderType::market, 1000, Side::buy);
+    }
+    uint64_t end_t = unix_time();
+    uint64_t llc = cache_misses.stop();
+    uint64_t l1d = l1d_misses.stop();
+
+    cout << name << (interleaved ? " (interleaved): " : " (sequential):  ")
+         << static_cast<double>(end_t - start_t) / matched_orders << " ns";
+    if (cache_misses.available()) {
+        cout << ", " << static_cast<double>(llc) / matched_orders << " cache misses";
+    }
+    if (l1d_misses.available()) {
+        cout << ", " << static_cast<double>(l1d) / matched_orders << " L1d misses";
+    }
+    cout << " per matched order\n";
+}
+
+// Same add/cancel/trade flow submitted one command at a time and in bursts, returns commands per second
+double measure_batch_throughput(size_t batch_size, uint64_t seed, uint32_t latency_sample_every = 0) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> qty_dist(1, 100);
+    std::uniform_int_distribution<int> tick_dist(1, 200);
+
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 18);
+    vector<uint64_t> warm_ids;
+    for (int i = 0; i < 20000; ++i) {
+        warm_ids.push_back(orderbook.add_order(qty_dist(rng), Price(100.0 - tick_dist(rng) / 100.0), BookSide::bid));
+        warm_ids.push_back(orderbook.add_order(qty_dist(rng), Price(100.0 + tick_dist(rng) / 100.0), BookSide::ask));
+    }
+    orderbook.set_latency_tracking(latency_sample_every != 0, latency_sample_every);
+
+    // 50% passive limits, 25% market orders, 25% cancels of warm-up orders (some already traded away)
+    const int NUM_COMMANDS = 400000;
+    vector<OrderCommand> commands(NUM_COMMANDS);
+    for (int i = 0; i < NUM_COMMANDS; ++i) {
+        OrderCommand& cmd = commands[i];
+        cmd.seq = i;
+        int action = rng() % 4;
+        cmd.side = (rng() & 1) ? Side::buy : Side::sell;
+        cmd.quantity = qty_dist(rng);
+        if (action < 2) {
+            cmd.price = Price(cmd.side == Side::buy ? 100.0 - tick_dist(rng) / 100.0 : 100.0 + tick_dist(rng) / 100.0);
+        } else if (action == 2) {
+            cmd.order_type = OrderType::market;
+        } else {
+            cmd.type = CommandType::cancel;
+            cmd.order_id = warm_ids[rng() % warm_ids.size()];
+        }
+    }
+
+    FillSink sink(batch_size);
+    uint64_t start_t = unix_time();
+    if (batch_size == 0) { // per-order entry point
+        for (const OrderCommand& cmd : commands) {
+            sink.push(orderbook.handle_command(cmd));
+            sink.clear();
+        }
+    } else {
+        std::span<const OrderCommand> all(commands);
+        for (size_t i = 0; i < all.size(); i += batch_size) {
+            orderbook.handle_orders(all.subspan(i, std::min(batch_size, all.size() - i)), sink);
+            sink.clear();
+        }
+    }
+    uint64_t end_t = unix_time();
+    return NUM_COMMANDS * 1e9 / (end_t - start_t);
+}
 
+// Sweeps asks where every level holds 1000 units shown 10 at a time, either as 100 plain orders or as 10 icebergs
+// of 100 with a peak of 10, so both books take the same number of fills. With plain orders and one iceberg
+// resting elsewhere, fills pay the reserve check without ever replenishing. Returns ns per fill.
+double measure_iceberg_matching(bool icebergs, bool iceberg_elsewhere) {
+    const int LEVELS = 500;
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 17);
+    for (int level = 0; level < LEVELS; ++level) {
+        const Price price(100.0 + level / 100.0);
+        for (int i = 0; i < (icebergs ? 10 : 100); ++i) {
+            if (icebergs) {
+                orderbook.add_iceberg(100, 10, price, BookSide::ask);
+            } else {
+                orderbook.add_order(10, price, BookSide::ask);
+            }
+        }
+    }
+    if (iceberg_elsewhere) {
+        orderbook.add_iceberg(100, 10, Price(50.0), BookSide::bid);
+    }
+
+    uint64_t start_t = unix_time();
+    while (!orderbook.get_asks().empty()) {
+        orderbook.handle_order(OrderType::market, 500, Side::buy);
+    }
+    uint64_t end_t = unix_time();
+    return static_cast<double>(end_t - start_t) / (LEVELS * 100);
+}
+
+// Trades one unit at a time against deep quotes around 100 with `pending` stops waiting far from the market, half
+// buy stops above and half sell stops below. Whether a trade fires a stop is a check of each side's best trigger,
+// so the cost per trade should not grow with the number pending.
+double measure_stop_overhead(size_t pending, uint64_t seed) {
+    const int NUM_TRADES = 1'000'000;
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 10);
+    orderbook.add_order(NUM_TRADES, Price(100.01), BookSide::ask);
+    orderbook.add_order(NUM_TRADES, Price(99.99), BookSide::bid);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> above(20000, 100000), below(100, 5000); // ticks
+    for (size_t i = 0; i < pending; ++i) {
+        if (i % 2 == 0) {
+            orderbook.add_stop(OrderType::market, 10, Side::buy, Price(above(rng) / 100.0));
+        } else {
+            orderbook.add_stop(OrderType::limit, 10, Side::sell, Price(below(rng) / 100.0), Price(1.00));
+        }
+    }
+
+    uint64_t start_t = unix_time();
+    for (int i = 0; i < NUM_TRADES; ++i) {
+        orderbook.handle_order(OrderType::market, 1, i % 2 == 0 ? Side::buy : Side::sell);
+    }
+    uint64_t end_t = unix_time();
+    if (orderbook.pending_stops() != pending) {
+        throw std::logic_error("A stop fired away from its trigger");
+    }
+    return static_cast<double>(end_t - start_t) / NUM_TRADES;
+}
+
+// A market maker keeps `quotes` bids at the touch while a plain order alternately improves the best bid by a tick
+// and is cancelled again. With delete+add every touch move costs a cancel and an add per quote; with primary pegs
+// the book moves them as one group. Returns ns per touch move.
+double measure_peg_following(bool pegged, int quotes) {
+    const int NUM_MOVES = 20'000;
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 12);
+    orderbook.add_order(100, Price(100.00), BookSide::bid);
+    orderbook.add_order(100, Price(101.00), BookSide::ask);
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < quotes; ++i) {
+        ids.push_back(pegged ? orderbook.add_peg(PegType::primary, 10, BookSide::bid)
+                             : orderbook.add_order(10, Price(100.00), BookSide::bid));
+    }
+
+    uint64_t start_t = unix_time();
+    uint64_t improving = 0;
+    for (int move = 0; move < NUM_MOVES; ++move) {
+        if (move % 2 == 0) {
+            improving = orderbook.add_order(100, Price(100.01), BookSide::bid);
+        } else {
+            orderbook.delete_order(improving);
+        }
+        if (!pegged) {
+            const Price touch = orderbook.best_quote(BookSide::bid);
+            for (uint64_t& id : ids) {
+                orderbook.delete_order(id);
+                id = orderbook.add_order(10, touch, BookSide::bid);
+            }
+        }
+    }
+    uint64_t end_t = unix_time();
+    return static_cast<double>(end_t - start_t) / NUM_MOVES;
+}
+
+// Sweeps 500 levels of 100 orders from owners 1..50 with takers of owner 99, so self-trade prevention, when on,
+// checks every maker and never fires
+double measure_stp_matching(StpMode mode) {
+    const int LEVELS = 500;
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 17);
+    orderbook.set_self_trade_prevention(mode);
+    for (int level = 0; level < LEVELS; ++level) {
+        const Price price(100.0 + level / 100.0);
+        for (int i = 0; i < 100; ++i) {
+            orderbook.add_order(10, price, BookSide::ask, 1 + i % 50);
+        }
+    }
+
+    uint64_t start_t = unix_time();
+    while (!orderbook.get_asks().empty()) {
+        orderbook.handle_order(OrderType::market, 500, Side::buy, Price{}, TimeInForce::gtc, 99);
+    }
+    uint64_t end_t = unix_time();
+    if (orderbook.self_trades_prevented() != 0) {
+        throw std::logic_error("Self-trade prevention fired between different owners");
+    }
+    return static_cast<double>(end_t - start_t) / (LEVELS * 100);
+}
+
+// Same seeded stream of limits around 100, small market orders and cancels from 1000 accounts, sent straight to
+// the book or through a RiskGate whose limits never bind. Both paths collect executions. Returns ns per command.
+double measure_risk_gate(bool gated, uint64_t seed) {
+    const int NUM_COMMANDS = 1'000'000;
+    const uint32_t ACCOUNTS = 1000;
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 17);
+    RiskConfig config;
+    config.max_accounts = ACCOUNTS + 1;
+    config.default_limits = AccountLimits{INT64_MAX / 4, INT64_MAX / 4};
+    RiskGate gate(orderbook, config);
+    ExecutionBuffer executions;
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> roll(0, 99), offset(1, 50), qty(1, 100);
+    std::uniform_int_distribution<uint32_t> account(1, ACCOUNTS);
+    std::vector<std::pair<uint64_t, uint32_t>> live; // resting id, account
+    live.reserve(NUM_COMMANDS);
+
+    uint64_t start_t = unix_time();
+    for (int i = 0; i < NUM_COMMANDS; ++i) {
+        const int r = roll(rng);
+        if (r < 20 && !live.empty()) {
+            size_t index = rng() % live.size();
+            auto [id, owner] = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            if (gated) {
+                gate.cancel(owner, id);
+            } else {
+                orderbook.delete_order(id);
+            }
+            continue;
+        }
+        const Side side = r % 2 == 0 ? Side::buy : Side::sell;
+        const OrderType type = r < 30 ? OrderType::market : OrderType::limit;
+        // Limits stay on their own side of 100, so they rest and the markets find something to hit
+        const Price price(side == Side::buy ? 100.0 - offset(rng) / 100.0 : 100.0 + offset(rng) / 100.0);
+        const uint32_t owner = account(rng);
+        uint64_t resting;
+        if (gated) {
+            resting = gate.submit(type, qty(rng), side, price, owner).order_id;
+        } else {
+            executions.clear();
+            orderbook.handle_order(type, qty(rng), side, price, executions, TimeInForce::gtc, owner);
+            resting = orderbook.last_resting_id();
+        }
+        if (resting != 0) {
+            live.emplace_back(resting, owner);
+        }
+    }
+    uint64_t end_t = unix_time();
+    return static_cast<double>(end_t - start_t) / NUM_COMMANDS;
+}
+
+// Cost of the checks alone against a two-sided book, cycling through accounts
+double measure_risk_check() {
+    const int NUM_CHECKS = 10'000'000;
+    Orderbook orderbook(false, prefaulted_ladder());
+    orderbook.add_order(100, Price(99.99), BookSide::bid);
+    orderbook.add_order(100, Price(100.01), BookSide::ask);
+    RiskGate gate(orderbook);
+    int rejected = 0;
+    uint64_t start_t = unix_time();
+    for (int i = 0; i < NUM_CHECKS; ++i) {
+        const Side side = i % 2 == 0 ? Side::buy : Side::sell;
+        rejected += gate.check(OrderType::limit, 1 + i % 100, side, Price(100.0), TimeInForce::gtc, 1 + i % 1000) !=
+                    RiskReject::none;
+    }
+    uint64_t end_t = unix_time();
+    if (rejected != 0) {
+        throw std::logic_error("Risk check rejected an order within limits");
+    }
+    return static_cast<double>(end_t - start_t) / NUM_CHECKS;
+}
+
+// Limits, cancels and small market orders within 30 ticks of the touch, balanced so the book stays small, so most commands change the view, with
+// reader threads copying it flat out. Returns the writer's wall and CPU ns per command; the CPU time leaves out
+// time the writer spent descheduled, which is all that readers cost it on a machine with fewer cores than threads.
+std::pair<double, double> measure_view_writer(bool attached, int num_readers, uint64_t seed, uint64_t& reads) {
+    const int NUM_COMMANDS = 1'000'000;
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 17);
+    BookView view;
+    if (attached) {
+        orderbook.set_book_view(&view);
+    }
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> total_reads{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < num_readers; ++i) {
+        readers.emplace_back([&] {
+            uint64_t n = 0;
+            int64_t sink = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                sink += view.read().bids[0].price.units;
+                n++;
+            }
+            total_reads.fetch_add(n + (sink < 0), std::memory_order_relaxed);
+        });
+    }
+
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> live;
+    live.reserve(NUM_COMMANDS);
+    timespec cpu_start, cpu_end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+    uint64_t start_t = unix_time();
+    for (int i = 0; i < NUM_COMMANDS; ++i) {
+        const uint64_t r = rng() % 10;
+        const bool buy = rng() % 2 == 0;
+        if (r < 4 && !live.empty()) {
+            size_t index = rng() % live.size();
+            orderbook.delete_order(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        } else if (r < 5) {
+            orderbook.handle_order(OrderType::market, 10, buy ? Side::buy : Side::sell);
+        } else {
+            const Price price(buy ? 99.99 - (rng() % 30) * 0.01 : 100.00 + (rng() % 30) * 0.01);
+            live.push_back(orderbook.add_order(10, price, buy ? BookSide::bid : BookSide::ask));
+        }
+    }
+    uint64_t end_t = unix_time();
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+    done.store(true, std::memory_order_relaxed);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    reads = total_reads.load();
+    const double cpu_ns = (cpu_end.tv_sec - cpu_start.tv_sec) * 1e9 + (cpu_end.tv_nsec - cpu_start.tv_nsec);
+    return {static_cast<double>(end_t - start_t) / NUM_COMMANDS, cpu_ns / NUM_COMMANDS};
+}
+
+// Buys and sells, market and limit, gtc, ioc and fok mixed at random around a two-sided book, so which matching
+// path an order takes cannot be predicted from the one before. Limits land within 20 ticks either side of 100,
+// about half of them crossing. Returns ns per order, branch misses per order go to branch_misses (0 when the
+// counter is unavailable).
+double measure_kernel_dispatch(uint64_t seed, double& branch_misses) {
+    const int NUM_ORDERS = 500'000;
+    Orderbook orderbook(false, prefaulted_ladder(), 1 << 19);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> roll(0, 99), offset(-20, 20), qty(1, 100);
+    for (int i = 1; i <= 20; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            orderbook.add_order(qty(rng), Price(100.0 - i / 100.0), BookSide::bid);
+            orderbook.add_order(qty(rng), Price(100.0 + i / 100.0), BookSide::ask);
+        }
+    }
+    struct Pending {
+        OrderType type;
+        Side side;
+        TimeInForce tif;
+        int quantity;
+        Price price;
+    };
+    std::vector<Pending> orders(NUM_ORDERS);
+    for (Pending& order : orders) {
+        const int r = roll(rng);
+        order.type = r < 30 ? OrderType::market : OrderType::limit;
+        order.side = roll(rng) < 50 ? Side::buy : Side::sell;
+        const int t = roll(rng);
+        order.tif = t < 60 ? TimeInForce::gtc : t < 85 ? TimeInForce::ioc : TimeInForce::fok;
+        order.quantity = qty(rng);
+        order.price = Price(100.0 + offset(rng) / 100.0);
+    }
+
+    PerfCounter misses = PerfCounter::branch_misses();
+    int units = 0;
+    misses.start();
+    uint64_t start_t = unix_time();
+    for (const Pending& order : orders) {
+        units += orderbook.handle_order(order.type, order.quantity, order.side, order.price, order.tif).first;
+    }
+    uint64_t end_t = unix_time();
+    branch_misses = static_cast<double>(misses.stop()) / NUM_ORDERS;
+    if (units == 0) {
+        throw std::logic_error("Nothing traded");
+    }
+    return static_cast<double>(end_t - start_t) / NUM_ORDERS;
+}
+
+// Id assignment plus index upkeep for a window of 100k resting orders: each step takes a new id, indexes it, looks
+// up a random resting order and drops another one at random, so lifetimes have a long tail. Either a shared atomic
+// counter with an unordered_map, as the book had before, or the book's own OrderIds with its paged OrderIndex.
+// Returns ns per step; heap allocations during the timed steps and index bytes per resting order at the end go
+// to the out parameters. The map's bytes are estimated as a 32 byte node per entry plus its bucket array.
+template <bool Paged>
+double measure_id_index(uint64_t seed, uint64_t& allocations, double& bytes_per_order) {
+    const size_t RESTING = 100'000;
+    const int NUM_STEPS = 2'000'000;
+    std::atomic<uint64_t> shared_counter{0};
+    std::unordered_map<uint64_t, Order*> map(RESTING);
+    OrderIds ids;
+    OrderIndex index(0, RESTING);
+    std::vector<Order> orders(RESTING);
+    std::vector<uint64_t> live; // parallel to orders
+    live.reserve(RESTING);
+    std::mt19937_64 rng(seed);
+
+    auto assign = [&](Order* order) {
+        const uint64_t id = Paged ? ids.next() : shared_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        order->id = id;
+        if constexpr (Paged) {
+            index.insert(id, order);
+        } else {
+            map.emplace(id, order);
+        }
+        return id;
+    };
+    for (size_t i = 0; i < RESTING; ++i) {
+        live.push_back(assign(&orders[i]));
+    }
+
+    uint64_t found = 0;
+    const uint64_t heap_before = g_heap_allocations;
+    uint64_t start_t = unix_time();
+    for (int i = 0; i < NUM_STEPS; ++i) {
+        const uint64_t probe = live[rng() % RESTING];
+        if constexpr (Paged) {
+            found += index.find(probe)->quantity == 0;
+        } else {
+            found += map.find(probe)->second->quantity == 0;
+        }
+        const size_t slot = rng() % RESTING;
+        if constexpr (Paged) {
+            index.erase(live[slot]);
+        } else {
+            map.erase(live[slot]);
+        }
+        live[slot] = assign(&orders[slot]);
+    }
+    uint64_t end_t = unix_time();
+    allocations = g_heap_allocations - heap_before;
+    bytes_per_order = static_cast<double>(Paged ? index.memory_bytes()
+                                                : map.size() * 32 + map.bucket_count() * sizeof(void*)) / RESTING;
+    if (found != static_cast<uint64_t>(NUM_STEPS)) {
+        throw std::logic_error("Lookup missed a resting order");
+    }
+    return static_cast<double>(end_t - start_t) / NUM_STEPS;
+}
+
+// The map book's id -> (side, price) lookup: std::unordered_map or FlatIdMap, both sized for 100k resting orders.
+// Each round inserts 100k fresh ids, looks up four times that many at random with one in four unknown, then erases
+// them all in random order. Returns ns per insert, lookup and erase; bytes per resting order with the map full go
+// to the out parameter, estimating the unordered_map as a 32 byte node per entry plus its bucket array.
+template <bool Flat>
+std::array<double, 3> measure_id_map(uint64_t seed, double& bytes_per_order) {
+    const size_t RESTING = 100'000;
+    const int ROUNDS = 20;
+    using Location = std::pair<BookSide, Price>;
+    std::unordered_map<uint64_t, Location> map(RESTING);
+    FlatIdMap<Location> flat(RESTING);
+    OrderIds ids;
+    std::vector<uint64_t> keys(RESTING), probes(RESTING * 4);
+    std::mt19937_64 rng(seed);
+    uint64_t insert_ns = 0, find_ns = 0, erase_ns = 0, found = 0;
+
+    for (int round = 0; round < ROUNDS; ++round) {
+        for (uint64_t& key : keys) {
+            key = ids.next();
+        }
+        for (uint64_t& probe : probes) {
+            probe = rng() % 4 == 0 ? ids.last() + 1 + rng() % RESTING : keys[rng() % RESTING];
+        }
+
+        uint64_t start_t = unix_time();
+        for (size_t i = 0; i < RESTING; ++i) {
+            const Location location{i & 1 ? BookSide::ask : BookSide::bid,
+                                    Price::from_units(100 * price_scale + i % 500 * price_scale / 100)};
+            if constexpr (Flat) {
+                flat.insert(keys[i], location);
+            } else {
+                map.emplace(keys[i], location);
+            }
+        }
+        uint64_t mid_t = unix_time();
+        insert_ns += mid_t - start_t;
+        bytes_per_order = static_cast<double>(Flat ? flat.memory_bytes()
+                                                   : map.size() * 32 + map.bucket_count() * sizeof(void*)) / RESTING;
+
+        for (uint64_t probe : probes) {
+            if constexpr (Flat) {
+                found += flat.find(probe) != nullptr;
+            } else {
+                found += map.find(probe) != map.end();
+            }
+        }
+        uint64_t end_t = unix_time();
+        find_ns += end_t - mid_t;
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+        start_t = unix_time();
+        for (uint64_t key : keys) {
+            if constexpr (Flat) {
+                flat.erase(key);
+            } else {
+                map.erase(key);
+            }
+        }
+        erase_ns += unix_time() - start_t;
+    }
+    if ((Flat ? flat.size() : map.size()) != 0 || found == 0) {
+        throw std::logic_error("Id map lost track of its entries");
+    }
+    const double operations = static_cast<double>(ROUNDS) * RESTING;
+    return {insert_ns / operations, find_ns / (operations * 4), erase_ns / operations};
+}
+
+// The book's price arithmetic with doubles, as the ladder and the map backend did it, and in fixed point. Each pair
+// is {double, fixed point} in ns per operation. convert turns a limit price into its tick: subtract, scale and
+// llround, or integer subtract and divide. level finds a resting level by price in a std::map over 1000 levels, the
+// map backend's lookup. notional values sweeps of four levels: each level's price divided back out of its tick and
+// summed in floating point, or one 128-bit multiply-add per level. How far the double total ends up from the exact
+// one goes to drift.
+struct PriceCosts {
+    double convert[2];
+    double level[2];
+    double notional[2];
+};
+
+PriceCosts measure_price_arithmetic(uint64_t seed, double& drift) {
+    const int NUM_OPS = 10'000'000;
+    const LadderConfig config;
+    PriceLadder<BookSide::bid> ladder(config);
+    // Kept out of the compiler's reach, the ladder read these from its config at run time
+    volatile double reference_source = config.reference_price.to_double();
+    volatile double ticks_source = std::round(1.0 / config.tick_size.to_double());
+    const double reference = reference_source, ticks_per_unit = ticks_source;
+
+    std::mt19937_64 rng(seed);
+    std::vector<uint32_t> ticks(NUM_OPS);
+    std::vector<double> decimals(NUM_OPS);
+    std::vector<Price> prices(NUM_OPS);
+    for (int i = 0; i < NUM_OPS; ++i) {
+        ticks[i] = static_cast<uint32_t>(rng() % config.num_levels);
+        prices[i] = ladder.tick_to_price(ticks[i]);
+        decimals[i] = prices[i].to_double();
+    }
+    PriceCosts costs;
+    uint64_t sink = 0;
+
+    uint64_t start_t = unix_time();
+    for (int i = 0; i < NUM_OPS; ++i) {
+        long long tick = std::llround((decimals[i] - reference) * ticks_per_unit);
+        if (tick < 0 || tick >= static_cast<long long>(config.num_levels)) {
+            throw std::out_of_range("Price outside of ladder range");
+        }
+        sink += tick;
+    }
+    uint64_t mid_t = unix_time();
+    for (int i = 0; i < NUM_OPS; ++i) {
+        sink += ladder.price_to_tick(prices[i]);
+    }
+    uint64_t end_t = unix_time();
+    costs.convert[0] = static_cast<double>(mid_t - start_t) / NUM_OPS;
+    costs.convert[1] = static_cast<double>(end_t - mid_t) / NUM_OPS;
+
+    const int LEVELS = 1000;
+    std::map<double, int, std::greater<double>> double_levels;
+    std::map<Price, int, std::greater<Price>> fixed_levels;
+    for (int level = 0; level < LEVELS; ++level) {
+        double_levels[ladder.tick_to_price(10'000 + level).to_double()] = level;
+        fixed_levels[ladder.tick_to_price(10'000 + level)] = level;
+    }
+    for (int i = 0; i < NUM_OPS; ++i) {
+        prices[i] = ladder.tick_to_price(10'000 + rng() % LEVELS);
+        decimals[i] = prices[i].to_double();
+    }
+    start_t = unix_time();
+    for (int i = 0; i < NUM_OPS; ++i) {
+        sink += double_levels.find(decimals[i])->second;
+    }
+    mid_t = unix_time();
+    for (int i = 0; i < NUM_OPS; ++i) {
+        sink += fixed_levels.find(prices[i])->second;
+    }
+    end_t = unix_time();
+    costs.level[0] = static_cast<double>(mid_t - start_t) / NUM_OPS;
+    costs.level[1] = static_cast<double>(end_t - mid_t) / NUM_OPS;
+
+    // Sweeps walk four consecutive levels from a random tick, each fill a random size
+    const int SWEEP = 4;
+    std::vector<int> quantities(NUM_OPS);
+    for (int i = 0; i < NUM_OPS; ++i) {
+        quantities[i] = 1 + static_cast<int>(rng() % 1000);
+    }
+    double double_total = 0;
+    Notional exact_total;
+    start_t = unix_time();
+    for (int i = 0; i + SWEEP <= NUM_OPS; i += SWEEP) {
+        double value = 0;
+        for (int level = 0; level < SWEEP; ++level) {
+            value += quantities[i + level] * (reference + (ticks[i] + level) / ticks_per_unit);
+        }
+        double_total += value;
+    }
+    mid_t = unix_time();
+    for (int i = 0; i + SWEEP <= NUM_OPS; i += SWEEP) {
+        Notional value;
+        for (int level = 0; level < SWEEP; ++level) {
+            value.add(quantities[i + level], ladder.tick_to_price(ticks[i] + level));
+        }
+        exact_total += value;
+    }
+    end_t = unix_time();
+    costs.notional[0] = static_cast<double>(mid_t - start_t) / NUM_OPS;
+    costs.notional[1] = static_cast<double>(end_t - mid_t) / NUM_OPS;
+    drift = std::abs(double_total - exact_total.to_double());
+
+    if (sink == 0) {
+        throw std::logic_error("Nothing was looked up");
+    }
+    return costs;
+}
+
+// Cost of timing and recording one operation on its own, in nanoseconds
+double measure_latency_scope_cost() {
+    const int NUM_RECORDS = 10'000'000;
+    uint64_t start_t = unix_time();
+    for (int i = 0; i < NUM_RECORDS; ++i) {
+        LatencyScope timer(true, LatencyOp::add);
+    }
+    uint64_t end_t = unix_time();
+    return static_cast<double>(end_t - start_t) / NUM_RECORDS;
+}
+
+void print_latency_percentiles(const LatencySnapshot& interval) {
+    const char* names[latency_op_count] = {"add", "market", "limit", "modify", "delete"};
+    cout << "op        count      p50 ns    p99 ns    p99.9 ns   max ns\n";
+    for (size_t i = 0; i < latency_op_count; ++i) {
+        LatencyOp op = static_cast<LatencyOp>(i);
+        if (interval.count(op) == 0) continue;
+        cout << std::left << setw(8) << names[i] << std::right << setw(8) << interval.count(op)
+             << setw(10) << static_cast<uint64_t>(interval.percentile(op, 0.5))
+             << setw(10) << static_cast<uint64_t>(interval.percentile(op, 0.99))
+             << setw(11) << static_cast<uint64_t>(interval.percentile(op, 0.999))
+             << setw(10) << static_cast<uint64_t>(interval.max(op)) << "\n";
+    }
+}
+
+// Usage: ./benchmark_orderbook [ladder|map|compare|alloc|cache|batch|latency|iceberg|stops|peg|stp|risk|view|kernels|ids|idmap|prices] [seed]
+// The seed is fixed by default so runs are reproducible. See benchmark_suite for the workload profiles.
+int main(int argc, char** argv) {
+    string mode = argc > 1 ? argv[1] : "ladder";
+    uint64_t seed = argc > 2 ? std::stoull(argv[2]) : 42;
+    cout << "Seed " << seed << endl;
+
+    if (mode == "ladder" || mode == "compare") {
+        cout << "=== Price ladder backend ===" << endl;
+        // Passive buys walk down from the lowest bid, so leave room below zero
+        LadderConfig config;
+        config.reference_price = Price(-1000.0);
+        config.num_levels = 1 << 18;
+        config.prefault_levels = config.num_levels;
+        // Create an empty orderbook (no dummy data), with room for every order without growing the pools
+        Orderbook orderbook(false, config, 1 << 17);
+        run_benchmark(orderbook, seed, mode == "ladder");
+    }
+    if (mode == "map" || mode == "compare") {
+        cout << "=== std::map backend ===" << endl;
+        MapOrderbook orderbook(false);
+        run_benchmark(orderbook, seed, mode == "map");
+    }
+    if (mode == "alloc") {
+        {
+            Orderbook orderbook(false, prefaulted_ladder(), 1 << 17);
+            uint64_t allocations = count_steady_state_allocations(orderbook, seed);
+            cout << "Price ladder backend: " << allocations << " heap allocations in steady state\n";
+            print_pool_stats("Order", orderbook.order_pool_stats());
+            print_pool_stats("Index", orderbook.index_pool_stats());
+        }
+        {
+            MapOrderbook orderbook(false);
+            uint64_t allocations = count_steady_state_allocations(orderbook, seed);
+            cout << "std::map backend: " << allocations << " heap allocations in steady state\n";
+        }
+    }
+    if (mode == "batch") {
+        double per_order = measure_batch_throughput(0, seed);
+        cout << "handle_command, one at a time: " << static_cast<uint64_t>(per_order) << " commands/s\n";
+        for (size_t batch_size : {1, 8, 64, 512}) {
+            double batched = measure_batch_throughput(batch_size, seed);
+            cout << "handle_orders, batch of " << batch_size << ": " << static_cast<uint64_t>(batched)
+                 << " commands/s (" << batched / per_order << "x)\n";
+        }
+    }
+    if (mode == "latency") {
+        cout << "TSC: " << tsc_ns_per_tick() << " ns per tick\n";
+        cout << "LatencyScope alone: " << measure_latency_scope_cost() << " ns per operation\n";
+        // Alternate runs so drift hits every variant, keep the best of each
+        double off = 0, every = 0, sampled = 0;
+        LatencySnapshot before = LatencyRecorder::snapshot();
+        for (int run = 0; run < 3; ++run) {
+            off = std::max(off, measure_batch_throughput(0, seed, 0));
+            every = std::max(every, measure_batch_throughput(0, seed, 1));
+            sampled = std::max(sampled, measure_batch_throughput(0, seed, 16));
+        }
+        LatencySnapshot interval = LatencyRecorder::snapshot().since(before);
+        cout << "Tracking off: " << 1e9 / off << " ns per command\n";
+        cout << "Every operation: " << 1e9 / every << " ns per command (" << 1e9 / every - 1e9 / off << " ns overhead)\n";
+        cout << "1 in 16 sampled: " << 1e9 / sampled << " ns per command (" << 1e9 / sampled - 1e9 / off
+             << " ns overhead)\n";
+        print_latency_percentiles(interval);
+    }
+    if (mode == "iceberg") {
+        // Alternate runs so drift hits every variant, keep the best of each
+        double plain = 1e9, flagged = 1e9, iceberg = 1e9;
+        for (int run = 0; run < 5; ++run) {
+            plain = std::min(plain, measure_iceberg_matching(false, false));
+            flagged = std::min(flagged, measure_iceberg_matching(false, true));
+            iceberg = std::min(iceberg, measure_iceberg_matching(true, false));
+        }
+        cout << "Plain orders: " << plain << " ns per fill\n";
+        cout << "Plain orders, an iceberg resting elsewhere: " << flagged << " ns per fill\n";
+        cout << "Icebergs, each fill of a peak replenishes: " << iceberg << " ns per fill\n";
+    }
+    if (mode == "stops") {
+        const size_t counts[] = {0, 1000, 100'000};
+        double best[3] = {1e9, 1e9, 1e9};
+        for (int run = 0; run < 5; ++run) {
+            for (int i = 0; i < 3; ++i) {
+                best[i] = std::min(best[i], measure_stop_overhead(counts[i], seed));
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            cout << counts[i] << " pending stops: " << best[i] << " ns per trade\n";
+        }
+    }
+    if (mode == "peg") {
+        for (int quotes : {1, 10, 100}) {
+            double replace = 1e9, pegged = 1e9;
+            for (int run = 0; run < 5; ++run) {
+                replace = std::min(replace, measure_peg_following(false, quotes));
+                pegged = std::min(pegged, measure_peg_following(true, quotes));
+            }
+            cout << quotes << " quotes at the touch: delete+add " << replace << " ns, pegged " << pegged
+                 << " ns per touch move (" << replace / pegged << "x)\n";
+        }
+    }
+    if (mode == "stp") {
+        double off = 1e9, on = 1e9;
+        for (int run = 0; run < 5; ++run) {
+            off = std::min(off, measure_stp_matching(StpMode::none));
+            on = std::min(on, measure_stp_matching(StpMode::cancel_oldest));
+        }
+        cout << "Self-trade prevention off: " << off << " ns per fill\n";
+        cout << "Self-trade prevention on, never triggered: " << on << " ns per fill\n";
+    }
+    if (mode == "risk") {
+        double ungated = 1e9, gated = 1e9;
+        for (int run = 0; run < 5; ++run) {
+            ungated = std::min(ungated, measure_risk_gate(false, seed));
+            gated = std::min(gated, measure_risk_gate(true, seed));
+        }
+        cout << "Ungated: " << ungated << " ns per command, " << 1e3 / ungated << "M commands/s\n";
+        cout << "Through the risk gate: " << gated << " ns per command, " << 1e3 / gated << "M commands/s\n";
+        cout << "Checks alone: " << measure_risk_check() << " ns per order\n";
+    }
+    if (mode == "view") {
+        cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+        // Alternate runs so drift hits every variant, keep the best of each
+        const pair<bool, int> variants[] = {{false, 0}, {true, 0}, {true, 1}, {true, 8}};
+        const char* names[] = {"No view", "View, 0 readers", "View, 1 reader", "View, 8 readers"};
+        double wall[4] = {1e9, 1e9, 1e9, 1e9}, cpu[4] = {1e9, 1e9, 1e9, 1e9};
+        uint64_t reads[4] = {};
+        for (int run = 0; run < 3; ++run) {
+            for (int i = 0; i < 4; ++i) {
+                auto [w, c] = measure_view_writer(variants[i].first, variants[i].second, seed, reads[i]);
+                wall[i] = std::min(wall[i], w);
+                cpu[i] = std::min(cpu[i], c);
+            }
+        }
+        for (int i = 0; i < 4; ++i) {
+            cout << names[i] << ": " << wall[i] << " ns per command wall, " << cpu[i] << " ns writer CPU, "
+                 << reads[i] << " reads in the last run\n";
+        }
+    }
+    if (mode == "kernels") {
+        double best = 1e9, misses = 0;
+        for (int run = 0; run < 5; ++run) {
+            double run_misses = 0;
+            const double ns = measure_kernel_dispatch(seed, run_misses);
+            if (ns < best) {
+                best = ns;
+                misses = run_misses;
+            }
+        }
+        cout << "Mixed side, type and time in force: " << best << " ns per order";
+        if (PerfCounter::branch_misses().available()) {
+            cout << ", " << misses << " branch misses per order";
+        } else {
+            cout << ", branch miss counter unavailable";
+        }
+        cout << "\n";
+    }
+    if (mode == "ids") {
+        double map_ns = 1e9, paged_ns = 1e9, map_bytes = 0, paged_bytes = 0;
+        uint64_t map_allocations = 0, paged_allocations = 0;
+        for (int run = 0; run < 5; ++run) {
+            map_ns = std::min(map_ns, measure_id_index<false>(seed, map_allocations, map_bytes));
+            paged_ns = std::min(paged_ns, measure_id_index<true>(seed, paged_allocations, paged_bytes));
+        }
+        cout << "Atomic counter + unordered_map: " << map_ns << " ns per step, " << map_allocations
+             << " heap allocations, ~" << map_bytes << " bytes per resting order\n";
+        cout << "OrderIds + paged OrderIndex: " << paged_ns << " ns per step, " << paged_allocations
+             << " heap allocations, " << paged_bytes << " bytes per resting order (" << map_ns / paged_ns << "x)\n";
+    }
+    if (mode == "idmap") {
+        std::array<double, 3> node{1e9, 1e9, 1e9}, flat{1e9, 1e9, 1e9};
+        double node_bytes = 0, flat_bytes = 0;
+        for (int run = 0; run < 5; ++run) {
+            const std::array<double, 3> n = measure_id_map<false>(seed, node_bytes);
+            const std::array<double, 3> f = measure_id_map<true>(seed, flat_bytes);
+            for (size_t i = 0; i < 3; ++i) {
+                node[i] = std::min(node[i], n[i]);
+                flat[i] = std::min(flat[i], f[i]);
+            }
+        }
+        cout << "unordered_map: " << node[0] << " ns insert, " << node[1] << " ns lookup, " << node[2]
+             << " ns erase, ~" << node_bytes << " bytes per resting order\n";
+        cout << "FlatIdMap: " << flat[0] << " ns insert, " << flat[1] << " ns lookup, " << flat[2]
+             << " ns erase, " << flat_bytes << " bytes per resting order\n";
+    }
+    if (mode == "prices") {
+        PriceCosts best{{1e9, 1e9}, {1e9, 1e9}, {1e9, 1e9}};
+        double drift = 0;
+        for (int run = 0; run < 5; ++run) {
+            const PriceCosts costs = measure_price_arithmetic(seed, drift);
+            for (int i = 0; i < 2; ++i) {
+                best.convert[i] = std::min(best.convert[i], costs.convert[i]);
+                best.level[i] = std::min(best.level[i], costs.level[i]);
+                best.notional[i] = std::min(best.notional[i], costs.notional[i]);
+            }
+        }
+        cout << "Price to tick: double " << best.convert[0] << " ns, fixed point " << best.convert[1] << " ns\n";
+        cout << "std::map level lookup: double keys " << best.level[0] << " ns, Price keys " << best.level[1]
+             << " ns\n";
+        cout << "Sweep notional per fill: double " << best.notional[0] << " ns, 128-bit " << best.notional[1]
+             << " ns, double total off by " << drift << "\n";
+    }
+    if (mode == "cache") {
+        cout << "Hot/cold Order: " << sizeof(Order) << " bytes hot + " << sizeof(OrderInfo) << " bytes cold, "
+             << "MapOrder: " << sizeof(MapOrder) << " bytes behind a unique_ptr\n";
+        if (!PerfCounter::cache_misses().available()) {
+            cout << "perf_event_open hardware counters unavailable, reporting time only\n";
+        }
+        for (bool interleaved : {false, true}) {
+            {
+                Orderbook orderbook(false, prefaulted_ladder(), 1 << 17);
+                measure_match_cache_misses(orderbook, "Hot/cold layout", interleaved, seed);
+            }
+            {
+                MapOrderbook orderbook(false);
+                measure_match_cache_misses(orderbook, "MapOrder layout", interleaved, seed);
+            }
+        }
+    }
     return 0;
 }
@@ -0,0 +1,298 @@
+/**
+ * @file benchmark_suite.cpp
+ * @brief Seeded workload profiles with throughput and per-operation percentiles, written as text and JSON.
+ *
+ * Each profile builds an uncrossed book around a mid price and then drives a stream of operations drawn
+ * from its own mix. A repetition runs the profile twice from the same seed: once untimed for throughput,
+ * once with the book's latency tracking on for p50/p99/p99.9/max per operation type. Warm-up operations
+ * run before either measurement and are never counted.
+ *
+ * Usage: ./benchmark_suite [--profile name] [--ops n] [--warmup n] [--reps n] [--seed n]
+ *                          [--label name] [--out file.json]
+ * Compare runs with: ./plot_dists.py --compare a.json b.json
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/helpers.hpp"
+#include "../include/latency_histogram.hpp"
+#include "../include/orderbook.hpp"
+
+using namespace std;
+
+namespace {
+
+constexpr double tick = 0.01;
+constexpr uint32_t ladder_levels = 1 << 17;
+
+// Keeps a long one-sided drift from walking off the ladder
+double on_ladder(double price) {
+    return std::clamp(price, tick, (ladder_levels - 1) * tick);
+}
+
+struct SuiteConfig {
+    string profile = "all";
+    size_t ops = 200000;
+    size_t warmup = 20000;
+    size_t reps = 3;
+    uint64_t seed = 42;
+    string label = "run";
+    string out = "benchmark_suite.json";
+};
+
+// Percent of operations of each kind, the rest are adds
+struct OpMix {
+    int cancel;
+    int modify;
+    int market;
+    int limit; // marketable limits
+    int ioc;   // marketable limits whose remainder is dropped
+    int fok;   // marketable limits that trade in full or not at all
+};
+
+struct Profile {
+    const char* name;
+    const char* description;
+    double mid;
+    int levels;          // initial levels per side
+    int orders_per_level;
+    int level_spacing;   // ticks between initial levels
+    int add_range;       // adds land within this many ticks behind the touch
+    int sweep_levels;    // aggressive orders are sized to take about this many levels
+    OpMix mix;
+};
+
+const Profile profiles[] = {
+    {"deep_cancels", "cancels deep inside long queues, refilled by adds", 100.0, 50, 200, 1, 50, 1, {60, 0, 0, 0, 0, 0}},
+    {"aggressive_sweeps", "market and marketable limits that take several levels", 100.0, 100, 20, 1, 100, 4, {0, 0, 20, 15, 0, 0}},
+    {"passive_touch", "quoting at and just behind the touch, cancel and replace", 100.0, 20, 10, 1, 3, 1, {40, 10, 2, 0, 0, 0}},
+    {"mixed", "realistic add/cancel/modify/trade mix", 100.0, 100, 30, 1, 40, 1, {35, 5, 7, 3, 0, 0}},
+    {"sparse_levels", "thousands of single-order levels spread over a wide ladder", 650.0, 5000, 1, 10, 5000, 8, {35, 0, 10, 5, 0, 0}},
+    {"ioc_fok", "takers that never rest, many FOKs too large for the levels they may reach", 100.0, 50, 20, 1, 20, 2, {20, 0, 0, 0, 15, 20}},
+};
+
+// Drives one profile, tracking live ids so cancels and modifies mostly hit resting orders
+class Workload {
+private:
+    const Profile& m_profile;
+    Orderbook& m_book;
+    mt19937_64 m_rng;
+    vector<uint64_t> m_live;
+    uniform_int_distribution<int> m_qty{1, 100};
+
+    double touch(BookSide side) {
+        double best = m_book.best_quote(side).to_double();
+        if (best != 0.0) return best;
+        return side == BookSide::bid ? m_profile.mid - tick : m_profile.mid + tick;
+    }
+
+    // A price on the given side at most add_range ticks behind the touch, never crossing the other side
+    double passive_price(BookSide side) {
+        int behind = static_cast<int>(m_rng() % (m_profile.add_range + 1));
+        if (side == BookSide::bid) {
+            double ceiling =
+                m_book.best_quote(BookSide::ask) != Price{} ? touch(BookSide::ask) - tick : touch(BookSide::bid);
+            return on_ladder(std::min(touch(BookSide::bid), ceiling) - behind * tick);
+        }
+        double floor = m_book.best_quote(BookSide::bid) != Price{} ? touch(BookSide::bid) + tick : touch(BookSide::ask);
+        return on_ladder(std::max(touch(BookSide::ask), floor) + behind * tick);
+    }
+
+    int sweep_quantity() {
+        return m_profile.orders_per_level * 50 * m_profile.sweep_levels / 2 + m_qty(m_rng);
+    }
+
+    uint64_t take_live() {
+        size_t pick = m_rng() % m_live.size();
+        uint64_t id = m_live[pick];
+        m_live[pick] = m_live.back();
+        m_live.pop_back();
+        return id;
+    }
+
+public:
+    Workload(const Profile& profile, Orderbook& book, uint64_t seed) : m_profile(profile), m_book(book), m_rng(seed) {}
+
+    void build() {
+        for (int level = 0; level < m_profile.levels; ++level) {
+            double offset = (1 + level * m_profile.level_spacing) * tick;
+            for (int i = 0; i < m_profile.orders_per_level; ++i) {
+                m_live.push_back(m_book.add_order(m_qty(m_rng), Price(m_profile.mid - offset), BookSide::bid));
+                m_live.push_back(m_book.add_order(m_qty(m_rng), Price(m_profile.mid + offset), BookSide::ask));
+            }
+        }
+    }
+
+    void step() {
+        const OpMix& mix = m_profile.mix;
+        int roll = static_cast<int>(m_rng() % 100);
+        bool buy = m_rng() & 1;
+
+        if ((roll -= mix.cancel) < 0 && !m_live.empty()) {
+            m_book.delete_order(take_live());
+        } else if ((roll -= mix.modify) < 0 && !m_live.empty()) {
+            m_book.modify_order(m_live[m_rng() % m_live.size()], m_qty(m_rng));
+        } else if ((roll -= mix.market) < 0) {
+            m_book.handle_order(OrderType::market, sweep_quantity(), buy ? Side::buy : Side::sell);
+        } else if ((roll -= mix.limit) < 0) {
+            // Priced a few levels through the opposite touch, any remainder rests
+            double through = m_profile.sweep_levels * m_profile.level_spacing * tick;
+            double price = on_ladder(buy ? touch(BookSide::ask) + through : touch(BookSide::bid) - through);
+            m_book.handle_order(OrderType::limit, sweep_quantity(), buy ? Side::buy : Side::sell, Price(price));
+            if (m_book.last_resting_id() != 0) m_live.push_back(m_book.last_resting_id());
+        } else if ((roll -= mix.ioc + mix.fok) < 0) {
+            // Limited to sweep_levels levels from the touch and sized so about half the FOKs are killed
+            TimeInForce tif = roll < -mix.fok ? TimeInForce::ioc : TimeInForce::fok;
+            double through = (m_profile.sweep_levels - 1) * m_profile.level_spacing * tick;
+            double price = on_ladder(buy ? touch(BookSide::ask) + through : touch(BookSide::bid) - through);
+            m_book.handle_order(OrderType::limit, sweep_quantity() * 2, buy ? Side::buy : Side::sell, Price(price),
+                                tif);
+        } else {
+            BookSide side = buy ? BookSide::bid : BookSide::ask;
+            m_live.push_back(m_book.add_order(m_qty(m_rng), Price(passive_price(side)), side));
+        }
+    }
+};
+
+struct OpResult {
+    uint64_t count = 0;
+    double p50 = 0, p99 = 0, p999 = 0, max = 0;
+};
+
+struct ProfileResult {
+    const Profile* profile;
+    vector<double> throughput; // operations per second, one per repetition
+    OpResult ops[latency_op_count];
+};
+
+const char* op_names[latency_op_count] = {"add", "market", "limit", "modify", "delete"};
+
+LadderConfig suite_ladder() {
+    // Every level backed up front, the profiles measure matching rather than first-touch page faults
+    return LadderConfig{Price(tick), Price{}, ladder_levels, ladder_levels};
+}
+
+// Builds the book, runs the warm-up and then the measured operations, returns their wall time in ns
+uint64_t run_once(const Profile& profile, const SuiteConfig& config, bool track_latency) {
+    Orderbook book(false, suite_ladder(), 1 << 20);
+    Workload workload(profile, book, config.seed);
+    workload.build();
+    for (size_t i = 0; i < config.warmup; ++i) workload.step();
+
+    book.set_latency_tracking(track_latency);
+    uint64_t start_t = unix_time();
+    for (size_t i = 0; i < config.ops; ++i) workload.step();
+    return unix_time() - start_t;
+}
+
+ProfileResult run_profile(const Profile& profile, const SuiteConfig& config) {
+    ProfileResult result{&profile, {}, {}};
+    LatencySnapshot before = LatencyRecorder::snapshot();
+    for (size_t rep = 0; rep < config.reps; ++rep) {
+        uint64_t elapsed = run_once(profile, config, false);
+        result.throughput.push_back(config.ops * 1e9 / elapsed);
+        run_once(profile, config, true);
+    }
+    LatencySnapshot interval = LatencyRecorder::snapshot().since(before);
+    for (size_t i = 0; i < latency_op_count; ++i) {
+        LatencyOp op = static_cast<LatencyOp>(i);
+        result.ops[i] = OpResult{interval.count(op), interval.percentile(op, 0.5), interval.percentile(op, 0.99),
+                                 interval.percentile(op, 0.999), interval.max(op)};
+    }
+    return result;
+}
+
+double median(vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+void print_result(const ProfileResult& result) {
+    cout << "=== " << result.profile->name << ": " << result.profile->description << " ===\n";
+    cout << "Throughput: " << static_cast<uint64_t>(median(result.throughput)) << " ops/s median of "
+         << result.throughput.size() << " (";
+    for (size_t i = 0; i < result.throughput.size(); ++i) {
+        cout << (i ? ", " : "") << static_cast<uint64_t>(result.throughput[i]);
+    }
+    cout << ")\n";
+    cout << "op          count    p50 ns    p99 ns  p99.9 ns    max ns\n";
+    for (size_t i = 0; i < latency_op_count; ++i) {
+        const OpResult& op = result.ops[i];
+        if (op.count == 0) continue;
+        cout << left << setw(8) << op_names[i] << right << setw(9) << op.count << fixed << setprecision(0)
+             << setw(10) << op.p50 << setw(10) << op.p99 << setw(10) << op.p999 << setw(10) << op.max << "\n";
+    }
+    cout << "\n";
+}
+
+void write_json(const vector<ProfileResult>& results, const SuiteConfig& config) {
+    ofstream out(config.out);
+    out << fixed << setprecision(1);
+    out << "{\n  \"label\": \"" << config.label << "\",\n  \"seed\": " << config.seed
+        << ",\n  \"ops\": " << config.ops << ",\n  \"warmup\": " << config.warmup
+        << ",\n  \"repetitions\": " << config.reps << ",\n  \"profiles\": [\n";
+    for (size_t p = 0; p < results.size(); ++p) {
+        const ProfileResult& result = results[p];
+        out << "    {\n      \"name\": \"" << result.profile->name << "\",\n      \"throughput_ops_per_s\": [";
+        for (size_t i = 0; i < result.throughput.size(); ++i) {
+            out << (i ? ", " : "") << result.throughput[i];
+        }
+        out << "],\n      \"throughput_median\": " << median(result.throughput) << ",\n      \"operations\": {";
+        bool first = true;
+        for (size_t i = 0; i < latency_op_count; ++i) {
+            const OpResult& op = result.ops[i];
+            if (op.count == 0) continue;
+            out << (first ? "\n" : ",\n") << "        \"" << op_names[i] << "\": {\"count\": " << op.count
+                << ", \"p50_ns\": " << op.p50 << ", \"p99_ns\": " << op.p99 << ", \"p999_ns\": " << op.p999
+                << ", \"max_ns\": " << op.max << "}";
+            first = false;
+        }
+        out << "\n      }\n    }" << (p + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    SuiteConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        string value = argv[i + 1];
+        if (flag == "--profile") config.profile = value;
+        else if (flag == "--ops") config.ops = stoull(value);
+        else if (flag == "--warmup") config.warmup = stoull(value);
+        else if (flag == "--reps") config.reps = std::max<size_t>(stoull(value), 1);
+        else if (flag == "--seed") config.seed = stoull(value);
+        else if (flag == "--label") config.label = value;
+        else if (flag == "--out") config.out = value;
+        else {
+            cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    cout << "Seed " << config.seed << ", " << config.warmup << " warm-up + " << config.ops << " measured ops, "
+         << config.reps << " repetitions\n\n";
+    vector<ProfileResult> results;
+    for (const Profile& profile : profiles) {
+        if (config.profile != "all" && config.profile != profile.name) continue;
+        results.push_back(run_profile(profile, config));
+        print_result(results.back());
+    }
+    if (results.empty()) {
+        cerr << "Unknown profile " << config.profile << "\n";
+        return 1;
+    }
+    write_json(results, config);
+    cout << "Wrote " << config.out << "\n";
+    return 0;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file journal.cpp
+ * @brief This file contains the implementation of the Journal, JournalReader and replay_journal.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/helpers.hpp"
+#include "../include/journal.hpp"
+#include "../include/orderbook.hpp"
+
+namespace {
+
+constexpr char journal_magic[8] = {'O', 'B', 'J', 'R', 'N', 'L', '\0', '\0'};
+constexpr uint32_t journal_version = 3;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+size_t file_bytes(size_t records) {
+    return sizeof(JournalHeader) + records * sizeof(JournalRecord);
+}
+
+}
+
+Journal::Journal(const std::string& path, const LadderConfig& ladder, const JournalConfig& config)
+    : m_capacity(std::max<size_t>(config.initial_records, 1)), m_config(config), m_wake_at(config.sync_every) {
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        throw_errno("Unable to open journal " + path);
+    }
+    map(m_capacity);
+
+    JournalHeader header{};
+    std::memcpy(header.magic, journal_magic, sizeof(header.magic));
+    header.version = journal_version;
+    header.record_size = sizeof(JournalRecord);
+    header.tick_size = ladder.tick_size;
+    header.reference_price = ladder.reference_price;
+    header.num_levels = ladder.num_levels;
+    std::memcpy(m_data, &header, sizeof(header));
+    ::msync(m_data, sizeof(header), MS_SYNC);
+
+    m_flusher = std::thread([this] { run_flusher(); });
+}
+
+Journal::~Journal() {
+    {
+        std::lock_guard<std::mutex> lock(m_remap);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_flusher.join();
+
+    sync_pending();
+    ::munmap(m_data, file_bytes(m_capacity));
+    // Drop the unused preallocated tail, readers stop at the end of the file
+    if (::ftruncate(m_fd, file_bytes(size())) == 0) {
+        ::fsync(m_fd);
+    }
+    ::close(m_fd);
+}
+
+// Sizes the file for capacity records, reserves its blocks and maps it prefaulted
+void Journal::map(size_t capacity) {
+    const size_t bytes = file_bytes(capacity);
+    if (::ftruncate(m_fd, bytes) != 0) {
+        throw_errno("Unable to size journal");
+    }
+    // Reserving the blocks now means a full disk fails here rather than as SIGBUS mid-append
+    if (int err = ::posix_fallocate(m_fd, 0, bytes); err != 0 && err != EOPNOTSUPP) {
+        errno = err;
+        throw_errno("Unable to preallocate journal");
+    }
+    void* data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, 0);
+    if (data == MAP_FAILED) {
+        throw_errno("Unable to map journal");
+    }
+    m_data = static_cast<std::byte*>(data);
+    m_capacity = capacity;
+}
+
+void Journal::grow() {
+    std::lock_guard<std::mutex> lock(m_remap);
+    ::munmap(m_data, file_bytes(m_capacity));
+    map(m_capacity * 2);
+}
+
+JournalRecord& Journal::append(JournalOp op, uint8_t side, int quantity, Price price, uint64_t order_id) {
+    size_t count = m_count.load(std::memory_order_relaxed);
+    if (count == m_capacity) {
+        grow();
+    }
+    JournalRecord& record = records()[count];
+    record = JournalRecord{op, side, 0, 0, quantity, price, order_id, unix_time()};
+    m_count.store(count + 1, std::memory_order_release);
+
+    if (m_config.sync_every != 0 && count + 1 >= m_wake_at) {
+        m_wake_at += m_config.sync_every;
+        m_wake.notify_one();
+    }
+    return record;
+}
+
+// Caller holds m_remap (or is the only thread left)
+void Journal::sync_pending() {
+    const size_t count = m_count.load(std::memory_order_acquire);
+    if (count == m_synced) {
+        return;
+    }
+    // msync wants a page aligned start
+    static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t begin = file_bytes(m_synced) / page * page;
+    const size_t end = file_bytes(count);
+    ::msync(m_data + begin, end - begin, MS_SYNC);
+    m_synced = count;
+}
+
+void Journal::sync() {
+    std::lock_guard<std::mutex> lock(m_remap);
+    sync_pending();
+    ::fdatasync(m_fd);
+}
+
+void Journal::run_flusher() {
+    std::unique_lock<std::mutex> lock(m_remap);
+    while (!m_stopping) {
+        m_wake.wait_for(lock, m_config.sync_interval);
+        sync_pending();
+    }
+}
+
+JournalReader::JournalReader(const std::string& path) {
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        throw_errno("Unable to open journal " + path);
+    }
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        ::close(m_fd);
+        throw_errno("Unable to stat journal " + path);
+    }
+    m_file_size = static_cast<size_t>(st.st_size);
+    if (m_file_size < sizeof(JournalHeader)) {
+        ::close(m_fd);
+        throw std::runtime_error("Journal " + path + " is truncated");
+    }
+
+    void* data = ::mmap(nullptr, m_file_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(m_fd);
+        throw_errno("Unable to map journal " + path);
+    }
+    m_data = static_cast<const std::byte*>(data);
+    ::madvise(data, m_file_size, MADV_SEQUENTIAL);
+
+    JournalHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (std::memcmp(header.magic, journal_magic, sizeof(header.magic)) != 0 ||
+        header.version != journal_version || header.record_size != sizeof(JournalRecord)) {
+        ::munmap(data, m_file_size);
+        ::close(m_fd);
+        throw std::runtime_error("Journal " + path + " has an unsupported format");
+    }
+    m_ladder = LadderConfig{header.tick_size, header.reference_price, header.num_levels};
+
+    // A crash leaves the preallocated tail zeroed, the first empty slot ends the journal
+    const size_t slots = (m_file_size - sizeof(JournalHeader)) / sizeof(JournalRecord);
+    const auto* first = reinterpret_cast<const JournalRecord*>(m_data + sizeof(JournalHeader));
+    m_count = 0;
+    while (m_count < slots && static_cast<uint8_t>(first[m_count].op) != 0) {
+        m_count++;
+    }
+}
+
+JournalReader::~JournalReader() {
+    ::munmap(const_cast<std::byte*>(m_data), m_file_size);
+    ::close(m_fd);
+}
+
+size_t replay_journal(const JournalReader& journal, Orderbook& book, size_t first_record, uint64_t preloaded_through) {
+    // Ids are handed out in increasing order, so journal id -> replayed id is a sorted vector
+    std::vector<std::pair<uint64_t, uint64_t>> ids;
+    auto remember = [&](uint64_t journal_id, uint64_t replayed_id) {
+        if (journal_id != 0 && replayed_id != 0) {
+            ids.emplace_back(journal_id, replayed_id);
+        }
+    };
+    auto lookup = [&](uint64_t journal_id) -> uint64_t {
+        if (journal_id <= preloaded_through) {
+            return journal_id;
+        }
+        auto it = std::lower_bound(ids.begin(), ids.end(), std::make_pair(journal_id, uint64_t{0}));
+        return it != ids.end() && it->first == journal_id ? it->second : 0;
+    };
+
+    size_t applied = 0;
+    auto records = journal.records();
+    for (size_t i = std::min(first_record, records.size()); i < records.size(); ++i) {
+        const JournalRecord& record = records[i];
+        // An owner record belongs to the command right after it
+        const uint32_t owner = i > 0 && records[i - 1].op == JournalOp::owner
+                                   ? static_cast<uint32_t>(records[i - 1].order_id) : 0;
+        // Commands that were rejected live are rejected again here, the same way
+        try {
+            switch (record.op) {
+                case JournalOp::add:
+                    remember(record.order_id,
+                             book.add_order(record.quantity, record.price, static_cast<BookSide>(record.side), owner));
+                    break;
+                case JournalOp::market:
+                    book.handle_order(OrderType::market, record.quantity, static_cast<Side>(record.side), Price{},
+                                      static_cast<TimeInForce>(record.tif), owner);
+                    break;
+                case JournalOp::limit:
+                    book.handle_order(OrderType::limit, record.quantity, static_cast<Side>(record.side), record.price,
+                                      static_cast<TimeInForce>(record.tif), owner);
+                    remember(record.order_id, book.last_resting_id());
+                    break;
+                case JournalOp::modify:
+                    book.modify_order(lookup(record.order_id), record.quantity);
+                    break;
+                case JournalOp::cancel:
+                    book.delete_order(lookup(record.order_id));
+                    break;
+                case JournalOp::iceberg:
+                    // Without its second half (a crash between the two appends) the add never happened
+                    if (i + 1 < records.size() && records[i + 1].op == JournalOp::iceberg_peak) {
+                        const JournalRecord& peak = records[i + 1];
+                        remember(peak.order_id, book.add_iceberg(record.quantity, peak.quantity, record.price,
+                                                                 static_cast<BookSide>(record.side), owner));
+                    }
+                    break;
+                case JournalOp::iceberg_peak:
+                    break;
+                case JournalOp::stop:
+                    // Same two record layout as an iceberg
+                    if (i + 1 < records.size() && records[i + 1].op == JournalOp::stop_price) {
+                        const JournalRecord& limit = records[i + 1];
+                        remember(limit.order_id, book.add_stop(static_cast<OrderType>(record.tif), record.quantity,
+                                                               static_cast<Side>(record.side), record.price,
+                                                               limit.price, owner));
+                    }
+                    break;
+                case JournalOp::stop_price:
+                    break;
+                case JournalOp::peg:
+                    remember(record.order_id, book.add_peg(static_cast<PegType>(record.tif), record.quantity,
+                                                           static_cast<BookSide>(record.side),
+                                                           static_cast<int>(record.price.units), owner));
+                    break;
+                case JournalOp::owner:
+                    break;
+                case JournalOp::stp:
+                    book.set_self_trade_prevention(static_cast<StpMode>(record.side));
+                    break;
+            }
+        } catch (const std::exception&) {
+        }
+        applied++;
+    }
+    return applied;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file latency_histogram.cpp
+ * @brief This file contains the TSC calibration, the per-thread registry and the snapshot math.
+ */
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../include/latency_histogram.hpp"
+
+namespace {
+
+std::mutex g_registry_mutex;
+std::vector<std::unique_ptr<ThreadLatency>> g_registry;
+
+}
+
+double tsc_ns_per_tick() {
+    static const double ns_per_tick = [] {
+        auto wall_start = std::chrono::steady_clock::now();
+        uint64_t tsc_start = read_tsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t tsc_end = read_tsc();
+        auto wall_end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(wall_end - wall_start).count();
+        return tsc_end > tsc_start ? ns / (tsc_end - tsc_start) : 1.0;
+    }();
+    return ns_per_tick;
+}
+
+// Taken once per thread, never on the recording path after that
+ThreadLatency* LatencyRecorder::register_thread() {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    g_registry.push_back(std::make_unique<ThreadLatency>());
+    return g_registry.back().get();
+}
+
+LatencySnapshot LatencyRecorder::snapshot() {
+    LatencySnapshot snapshot;
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    for (const auto& thread : g_registry) {
+        for (size_t op = 0; op < latency_op_count; ++op) {
+            for (size_t bucket = 0; bucket < LatencyHistogram::bucket_count; ++bucket) {
+                snapshot.m_counts[op][bucket] += thread->ops[op].count(bucket);
+            }
+        }
+    }
+    return snapshot;
+}
+
+LatencySnapshot LatencySnapshot::since(const LatencySnapshot& earlier) const {
+    LatencySnapshot interval;
+    for (size_t op = 0; op < latency_op_count; ++op) {
+        for (size_t bucket = 0; bucket < LatencyHistogram::bucket_count; ++bucket) {
+            interval.m_counts[op][bucket] = m_counts[op][bucket] - earlier.m_counts[op][bucket];
+        }
+    }
+    return interval;
+}
+
+uint64_t LatencySnapshot::count(LatencyOp op) const {
+    uint64_t total = 0;
+    for (uint64_t n : m_counts[static_cast<size_t>(op)]) {
+        total += n;
+    }
+    return total;
+}
+
+double LatencySnapshot::percentile(LatencyOp op, double q) const {
+    const auto& counts = m_counts[static_cast<size_t>(op)];
+    const uint64_t total = count(op);
+    if (total == 0) {
+        return 0;
+    }
+    // Rank of the sample at q, the top bucket for q == 1
+    uint64_t rank = static_cast<uint64_t>(q * total);
+    if (rank >= total) rank = total - 1;
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LatencyHistogram::bucket_count; ++bucket) {
+        seen += counts[bucket];
+        if (seen > rank) {
+            return LatencyHistogram::bucket_limit(bucket) * tsc_ns_per_tick();
+        }
+    }
+    return 0;
+}
@@ -11,6 +11,7 @@
 
 // Run command: g++ -std=c++14 ./src/main.cpp ./src/order.cpp ./src/orderbook.cpp -o main
 #include <iostream>
+#include <stdexcept>
 #include "../include/orderbook.hpp"
 #include "../include/helpers.hpp"
 
@@ -52,11 +53,15 @@ int main(){
 				cout << "\nSubmitting market " << ((side == Side::buy) ? "buy":"sell") 
                     << " order for " << quantity << " units.." << "\n";
 				
-				u_int64_t start_time = unix_time();
-                std::pair<int,double> fill = ob.handle_order(order_type, quantity, side);
-				u_int64_t end_time = unix_time();
-			    
-                print_fill(fill, quantity, start_time, end_time);
+				try {
+					u_int64_t start_time = unix_time();
+					std::pair<int, Notional> fill = ob.handle_order(order_type, quantity, side);
+					u_int64_t end_time = unix_time();
+
+					print_fill(fill, quantity, start_time, end_time);
+				} catch (const std::exception& e) {
+					cout << "Order rejected: " << e.what() << "\n";
+				}
 			}else if(order_type == OrderType::limit){
 				cout << "\nEnter limit price: ";
 				cin >> price;
@@ -64,11 +69,16 @@ int main(){
 				cout << "\nSubmitting limit " << ((side == Side::buy) ? "buy":"sell") 
                     << " order for " << quantity << " units @ $" << price << ".." << "\n";
 
-				u_int64_t start_time = unix_time();
-                std::pair<int,double> fill = ob.handle_order(order_type, quantity, side, price);
-				u_int64_t end_time = unix_time();
+				// Prices off the ladder, such as negative ones, are rejected rather than ending the session
+				try {
+					u_int64_t start_time = unix_time();
+					std::pair<int, Notional> fill = ob.handle_order(order_type, quantity, side, Price(price));
+					u_int64_t end_time = unix_time();
 
-                print_fill(fill, quantity, start_time, end_time);
+					print_fill(fill, quantity, start_time, end_time);
+				} catch (const std::exception& e) {
+					cout << "Order rejected: " << e.what() << "\n";
+				}
 			}
 			cout << "\n";
 		}
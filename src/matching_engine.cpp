@@ -0,0 +1,59 @@
+/**
+ * @file matching_engine.cpp
+ * @brief This file contains the implementation of the MatchingEngine class.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "../include/matching_engine.hpp"
+
+MatchingEngine::MatchingEngine(size_t num_symbols, const EngineConfig& config)
+    : m_num_shards(std::max<size_t>(config.num_shards, 1)) {
+    if (num_symbols > OrderIds::max_spaces) {
+        throw std::invalid_argument("More symbols than order id spaces");
+    }
+    // A symbol's book draws its ids from the id space with the symbol's number, so ids are unique engine wide
+    m_books.reserve(num_symbols);
+    for (size_t i = 0; i < num_symbols; ++i) {
+        const LadderConfig& ladder = i < config.symbol_ladders.size() ? config.symbol_ladders[i] : config.ladder;
+        m_books.push_back(std::make_unique<Orderbook>(false, ladder, config.order_capacity, i));
+    }
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t shard = 0; shard < m_num_shards; ++shard) {
+        // Each shard sees only its own books, every other slot stays null and is rejected
+        std::vector<Orderbook*> owned(num_symbols, nullptr);
+        for (SymbolId symbol = shard; symbol < num_symbols; symbol += m_num_shards) {
+            owned[symbol] = m_books[symbol].get();
+        }
+
+        GatewayConfig gateway_config;
+        gateway_config.idle_spins = config.idle_spins;
+        if (config.pin_workers) {
+            gateway_config.matching_cpu = static_cast<int>((config.first_cpu + shard) % cores);
+        }
+        m_shards.push_back(std::make_unique<OrderGateway>(std::move(owned), gateway_config));
+    }
+}
+
+size_t MatchingEngine::memory_bytes() const {
+    size_t bytes = 0;
+    for (const auto& book : m_books) {
+        bytes += book->memory_bytes();
+    }
+    return bytes;
+}
+
+void MatchingEngine::start() {
+    for (auto& shard : m_shards) {
+        shard->start();
+    }
+}
+
+void MatchingEngine::stop() {
+    for (auto& shard : m_shards) {
+        shard->stop();
+    }
+}
@@ -0,0 +1,293 @@
+/**
+ * @file mbo_feed.cpp
+ * @brief This file contains the implementation of the MboReader, replay_mbo and generate_mbo_feed.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/execution.hpp"
+#include "../include/flat_id_map.hpp"
+#include "../include/helpers.hpp"
+#include "../include/mbo_feed.hpp"
+#include "../include/orderbook.hpp"
+
+namespace {
+
+constexpr char mbo_magic[8] = {'O', 'B', 'M', 'B', 'O', '\0', '\0', '\0'};
+constexpr uint32_t mbo_version = 2;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+}
+
+MboReader::MboReader(const std::string& path) {
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        throw_errno("Unable to open feed " + path);
+    }
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        ::close(m_fd);
+        throw_errno("Unable to stat feed " + path);
+    }
+    m_file_size = static_cast<size_t>(st.st_size);
+    if (m_file_size < sizeof(MboHeader)) {
+        ::close(m_fd);
+        throw std::runtime_error("Feed " + path + " is truncated");
+    }
+
+    void* data = ::mmap(nullptr, m_file_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(m_fd);
+        throw_errno("Unable to map feed " + path);
+    }
+    m_data = static_cast<const std::byte*>(data);
+    ::madvise(data, m_file_size, MADV_SEQUENTIAL);
+
+    std::memcpy(&m_header, m_data, sizeof(m_header));
+    const bool valid = std::memcmp(m_header.magic, mbo_magic, sizeof(m_header.magic)) == 0 &&
+                       m_header.version == mbo_version && m_header.record_size == sizeof(MboRecord);
+    if (!valid || m_header.record_count > (m_file_size - sizeof(MboHeader)) / sizeof(MboRecord)) {
+        ::munmap(data, m_file_size);
+        ::close(m_fd);
+        throw std::runtime_error("Feed " + path + (valid ? " is truncated" : " has an unsupported format"));
+    }
+}
+
+MboReader::~MboReader() {
+    ::munmap(const_cast<std::byte*>(m_data), m_file_size);
+    ::close(m_fd);
+}
+
+MboReplayStats replay_mbo(const MboReader& feed, Orderbook& book, const MboReplayConfig& config) {
+    MboIdMap ids(feed.header().max_order_id);
+    MboReplayStats stats;
+    auto records = feed.records();
+    const uint64_t first_timestamp = records.empty() ? 0 : records[0].timestamp;
+
+    const uint64_t start_t = unix_time();
+    for (const MboRecord& record : records) {
+        if (config.paced) {
+            // Spin rather than sleep, a sleep overshoots by far more than the gap between messages
+            const uint64_t due = start_t + static_cast<uint64_t>((record.timestamp - first_timestamp) / config.speed);
+            uint64_t now;
+            while ((now = unix_time()) < due) {
+            }
+            stats.max_lag_ns = std::max(stats.max_lag_ns, now - due);
+        }
+
+        const BookSide side = static_cast<BookSide>(record.side);
+        switch (record.op) {
+            case MboOp::add:
+                if (!ids.in_range(record.order_id)) {
+                    stats.rejected++;
+                    break;
+                }
+                try {
+                    ids.set(record.order_id, book.add_order(record.quantity, record.price, side));
+                } catch (const std::exception&) {
+                    stats.rejected++;
+                }
+                break;
+            case MboOp::modify:
+                if (!book.modify_order(ids.get(record.order_id), record.quantity)) {
+                    stats.mismatches++;
+                }
+                break;
+            case MboOp::cancel:
+                if (!book.delete_order(ids.get(record.order_id))) {
+                    stats.mismatches++;
+                } else {
+                    ids.set(record.order_id, 0);
+                }
+                break;
+            case MboOp::execute: {
+                const Side taker = side == BookSide::bid ? Side::sell : Side::buy;
+                if (book.handle_order(OrderType::market, record.quantity, taker).first < record.quantity) {
+                    stats.mismatches++;
+                }
+                break;
+            }
+        }
+    }
+    stats.elapsed_ns = unix_time() - start_t;
+    stats.messages = records.size();
+    return stats;
+}
+
+MboGeneratorStats generate_mbo_feed(const std::string& path, size_t num_records, uint64_t seed) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Unable to create feed " + path);
+    }
+    const LadderConfig ladder{};
+    MboHeader header{};
+    std::memcpy(header.magic, mbo_magic, sizeof(header.magic));
+    header.version = mbo_version;
+    header.record_size = sizeof(MboRecord);
+    header.tick_size = ladder.tick_size;
+    header.reference_price = ladder.reference_price;
+    header.num_levels = ladder.num_levels;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header)); // counts are patched in at the end
+
+    Orderbook book(false, ladder);
+    ExecutionBuffer executions;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::lognormal_distribution<double> add_size(std::log(100.0), 0.8);
+    std::lognormal_distribution<double> sweep_size(std::log(150.0), 1.0);
+    std::geometric_distribution<size_t> cancel_age(0.02);
+
+    // Per external id: book id (0 once gone), side, price and remaining size
+    struct Resting {
+        uint64_t book_id;
+        BookSide side;
+        Price price;
+        int quantity;
+    };
+    std::vector<Resting> orders(1);
+    const double resting_target = 20000;
+    FlatIdMap<uint64_t> external_of(static_cast<size_t>(resting_target));
+    std::vector<uint64_t> live; // external ids, newest last, may hold a few that were filled since
+    // Prices are worked out in price units, every one of them a whole number of ticks
+    const int64_t tick = ladder.tick_size.units;
+    const int64_t top = ladder.reference_price.units + (ladder.num_levels - 1) * tick;
+    int64_t last_trade = Price(100.0).units;
+    uint64_t clock = 0;
+    double burst = 0; // rises after each trade and decays, shortening gaps like a self-exciting process
+
+    std::vector<MboRecord> buffer;
+    buffer.reserve(4096);
+    size_t written = 0;
+    auto emit = [&](MboOp op, const Resting& order, int quantity, Price price, uint64_t external_id) {
+        buffer.push_back(MboRecord{op, static_cast<uint8_t>(order.side), 0, quantity, price, external_id, clock});
+        if (buffer.size() == buffer.capacity()) {
+            out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(MboRecord));
+            written += buffer.size();
+            buffer.clear();
+        }
+    };
+
+    // Newest orders are the likeliest to go, filled ones found on the way are dropped
+    auto pick_live = [&]() -> uint64_t {
+        while (!live.empty()) {
+            size_t age = std::min(cancel_age(rng), live.size() - 1);
+            size_t index = live.size() - 1 - age;
+            uint64_t external_id = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            if (orders[external_id].book_id != 0) {
+                return external_id;
+            }
+        }
+        return 0;
+    };
+
+    while (written + buffer.size() < num_records) {
+        // Poisson arrivals, a few hundred thousand messages a second when calm and ten times that in a burst
+        const double rate_per_ns = 1.0 / 4000 * (1 + 9 * burst);
+        clock += static_cast<uint64_t>(-std::log(1.0 - uniform(rng)) / rate_per_ns) + 1;
+        burst *= 0.97;
+
+        // Adds, modifies and trades arrive at fixed shares, each resting order is cancelled at a constant
+        // hazard, so depth stays bounded instead of growing with the feed
+        const double cancel_share = 0.44 * static_cast<double>(live.size()) / resting_target;
+        const double roll = uniform(rng) * (0.56 + cancel_share);
+        const bool buy = uniform(rng) < 0.5;
+        const int64_t best_bid = book.best_quote(BookSide::bid).units;
+        const int64_t best_ask = book.best_quote(BookSide::ask).units;
+        const bool opposite_empty = buy ? best_ask == 0 : best_bid == 0;
+
+        if (roll < 0.06 && !opposite_empty) {
+            // Aggressive order, written as the executes it produced
+            int quantity = std::max(1, static_cast<int>(sweep_size(rng)));
+            executions.clear();
+            book.handle_order(OrderType::market, quantity, buy ? Side::buy : Side::sell, Price{}, executions);
+            for (const Execution& execution : executions.executions()) {
+                uint64_t external_id = *external_of.find(execution.maker_id);
+                Resting& maker = orders[external_id];
+                emit(MboOp::execute, maker, execution.quantity, execution.price, external_id);
+                maker.quantity = execution.maker_remaining;
+                if (maker.quantity == 0) {
+                    maker.book_id = 0;
+                    external_of.erase(execution.maker_id);
+                }
+                last_trade = execution.price.units;
+            }
+            burst = std::min(1.0, burst + 0.5);
+        } else if (roll < 0.06 + cancel_share && !live.empty()) {
+            uint64_t external_id = pick_live();
+            if (external_id == 0) continue;
+            Resting& order = orders[external_id];
+            book.delete_order(order.book_id);
+            external_of.erase(order.book_id);
+            order.book_id = 0;
+            emit(MboOp::cancel, order, 0, order.price, external_id);
+        } else if (roll < 0.10 + cancel_share && !live.empty()) {
+            // Size reductions keep priority, the order stays live
+            uint64_t external_id = pick_live();
+            if (external_id == 0) continue;
+            live.push_back(external_id);
+            Resting& order = orders[external_id];
+            if (order.quantity < 2) continue;
+            order.quantity = std::max(1, static_cast<int>(order.quantity * uniform(rng)));
+            book.modify_order(order.book_id, order.quantity);
+            emit(MboOp::modify, order, order.quantity, order.price, external_id);
+        } else {
+            // Power law distance behind the own touch, now and then one tick inside the spread
+            const BookSide side = buy ? BookSide::bid : BookSide::ask;
+            const int64_t own = buy ? best_bid : best_ask;
+            const int64_t other = buy ? best_ask : best_bid;
+            const int behind = std::min(200, static_cast<int>(std::pow(1.0 - uniform(rng), -1.0 / 1.3)) - 1);
+            int64_t units;
+            if (own == 0) {
+                units = buy ? last_trade - tick * (1 + behind) : last_trade + tick * (1 + behind);
+            } else if (uniform(rng) < 0.1 && other != 0 && std::abs(other - own) > tick) {
+                units = buy ? own + tick : own - tick;
+            } else {
+                units = buy ? own - tick * behind : own + tick * behind;
+            }
+            if (other != 0) {
+                units = buy ? std::min(units, other - tick) : std::max(units, other + tick);
+            }
+            const Price price = Price::from_units(std::clamp(units, tick, top));
+
+            const int quantity = std::max(1, static_cast<int>(add_size(rng)));
+            const uint64_t book_id = book.add_order(quantity, price, side);
+            const uint64_t external_id = orders.size();
+            orders.push_back(Resting{book_id, side, price, quantity});
+            external_of.insert(book_id, external_id);
+            live.push_back(external_id);
+            emit(MboOp::add, orders.back(), quantity, price, external_id);
+        }
+    }
+    out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(MboRecord));
+    written += buffer.size();
+
+    header.record_count = written;
+    header.max_order_id = orders.size() - 1;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) {
+        throw std::runtime_error("Unable to write feed " + path);
+    }
+
+    MboGeneratorStats stats;
+    stats.records = written;
+    stats.resting_orders = book.order_pool_stats().in_use;
+    stats.best_bid = book.best_quote(BookSide::bid);
+    stats.best_ask = book.best_quote(BookSide::ask);
+    return stats;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file order_gateway.cpp
+ * @brief This file contains the implementation of the OrderGateway class.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "../include/helpers.hpp"
+#include "../include/order_gateway.hpp"
+
+OrderGateway::OrderGateway(Orderbook& book, const GatewayConfig& config)
+    : OrderGateway(std::vector<Orderbook*>{&book}, config) {}
+
+OrderGateway::OrderGateway(std::vector<Orderbook*> books, const GatewayConfig& config)
+    : m_books(std::move(books)), m_config(config),
+      m_commands(std::make_unique<CommandRing>()), m_events(std::make_unique<EventRing>()) {}
+
+OrderGateway::~OrderGateway() {
+    stop();
+}
+
+void OrderGateway::start() {
+    if (m_running.exchange(true)) return;
+    m_thread = std::thread([this] { run(); });
+}
+
+void OrderGateway::stop() {
+    if (!m_running.exchange(false)) return;
+    m_thread.join();
+}
+
+// Splits the batch into runs of one symbol and hands each run to its book in one call
+void OrderGateway::process_batch(std::span<const OrderCommand> batch, FillSink& sink) {
+    size_t begin = 0;
+    while (begin < batch.size()) {
+        const uint32_t symbol = batch[begin].symbol;
+        size_t end = begin + 1;
+        while (end < batch.size() && batch[end].symbol == symbol) {
+            end++;
+        }
+
+        Orderbook* book = symbol < m_books.size() ? m_books[symbol] : nullptr;
+        if (book != nullptr) {
+            book->handle_orders(batch.subspan(begin, end - begin), sink);
+        } else {
+            for (size_t i = begin; i < end; ++i) {
+                OrderEvent event;
+                event.type = EventType::reject;
+                event.order_id = batch[i].order_id;
+                event.seq = batch[i].seq;
+                event.timestamp = batch[i].timestamp;
+                event.symbol = symbol;
+                sink.push(event);
+            }
+        }
+        begin = end;
+    }
+}
+
+// Back-pressure: wait for the consumer rather than drop an event, unless we are stopping
+void OrderGateway::publish(const FillSink& sink) {
+    for (const OrderEvent& event : sink.events()) {
+        while (!m_events->try_push(event)) {
+            if (!m_running.load(std::memory_order_relaxed)) return;
+            std::this_thread::yield();
+        }
+    }
+}
+
+void OrderGateway::run() {
+    if (m_config.matching_cpu >= 0) {
+        pin_current_thread(m_config.matching_cpu);
+    }
+
+    const size_t max_batch = m_config.max_batch ? m_config.max_batch : 1;
+    std::vector<OrderCommand> batch(max_batch);
+    FillSink sink(max_batch);
+
+    auto drain = [&]() -> size_t {
+        size_t n = 0;
+        while (n < max_batch && m_commands->try_pop(batch[n])) {
+            n++;
+        }
+        return n;
+    };
+
+    unsigned idle = 0;
+    while (m_running.load(std::memory_order_relaxed)) {
+        size_t n = drain();
+        if (n == 0) {
+            if (++idle >= m_config.idle_spins) {
+                idle = 0;
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        idle = 0;
+
+        process_batch(std::span<const OrderCommand>(batch.data(), n), sink);
+        publish(sink);
+        sink.clear();
+    }
+
+    // Drain what was submitted before stop()
+    while (size_t n = drain()) {
+        process_batch(std::span<const OrderCommand>(batch.data(), n), sink);
+        for (const OrderEvent& event : sink.events()) {
+            m_events->try_push(event);
+        }
+        sink.clear();
+    }
+}
@@ -1,55 +1,298 @@
 /**
- * @file order.cpp
+ * @file orderbook.cpp
  * @brief This file contains the implementation of the Orderbook class.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <stdlib.h>
-#include <map>
 #include <thread>
 #include <iomanip>
-#include <memory>
-#include <deque>
+#include <cstring>
+#include <stdexcept>
 
 #include "../include/order.hpp"
 #include "../include/orderbook.hpp"
 
 using namespace std;
 
-void Orderbook::add_order(int qty, double price, BookSide side) {
-    auto order = std::make_unique<Order>(qty, price, side);
-    uint64_t order_id = order->id;
+namespace {
+
+void check_owner(uint32_t owner) {
+    if (owner == Order::no_owner) {
+        throw std::invalid_argument("Owner id is reserved");
+    }
+}
+
+}
+
+Order* Orderbook::add_order_at_tick(int qty, size_t tick, BookSide side, uint64_t id, uint32_t owner) {
+    Order* order = m_order_pool.create_with_id(id, qty, m_bids.tick_to_price(tick), side, unix_time());
+    order->owner = owner;
+    m_order_pool.info(order).tick = static_cast<uint32_t>(tick);
     if (side == BookSide::bid) {
-        m_bids[price].push_back(std::move(order));
-        m_order_metadata[order_id] = make_pair(BookSide::bid, price); // cache
+        m_bids.push_back(tick, order);
     } else {
-        m_asks[price].push_back(std::move(order));
-        m_order_metadata[order_id] = make_pair(BookSide::ask, price); // cache
+        m_asks.push_back(tick, order);
+    }
+    m_orders.insert(order->id, order);
+    m_last_resting_id = order->id;
+    touch(side, tick);
+    return order;
+}
+
+// Writes the command ahead of matching, returns the record so the id it produces can be filled in
+JournalRecord* Orderbook::journal(JournalOp op, uint8_t side, int qty, Price price, uint64_t id) {
+    if (m_journal == nullptr) {
+        return nullptr;
+    }
+    return &m_journal->append(op, side, qty, price, id);
+}
+
+uint64_t Orderbook::add_order(int qty, Price price, BookSide side, uint32_t owner) {
+    LatencyScope timer(sample_latency(), LatencyOp::add);
+    check_owner(owner);
+    journal_owner(owner);
+    JournalRecord* record = journal(JournalOp::add, static_cast<uint8_t>(side), qty, price);
+    // Both ladders share one configuration, so either can convert
+    uint64_t id = add_order_at_tick(qty, m_bids.limit_tick(price, side), side, m_ids.next(), owner)->id;
+    if (record) record->order_id = id;
+    publish_levels();
+    return id;
+}
+
+uint64_t Orderbook::add_iceberg(int qty, int peak, Price price, BookSide side, uint32_t owner) {
+    if (qty <= 0 || peak <= 0) {
+        throw std::invalid_argument("Iceberg needs a positive quantity and peak");
+    }
+    check_owner(owner);
+    LatencyScope timer(sample_latency(), LatencyOp::add);
+    // Two records, the second one carries the peak and the id
+    journal_owner(owner);
+    journal(JournalOp::iceberg, static_cast<uint8_t>(side), qty, price);
+    JournalRecord* record = journal(JournalOp::iceberg_peak, static_cast<uint8_t>(side), peak, price);
+
+    const size_t tick = m_bids.limit_tick(price, side);
+    const int shown = std::min(qty, peak);
+    Order* order = add_order_at_tick(shown, tick, side, m_ids.next(), owner);
+    if (qty > shown) {
+        OrderInfo& info = m_order_pool.info(order);
+        info.peak = peak;
+        info.hidden = qty - shown;
+        (side == BookSide::bid ? m_bids.level(tick) : m_asks.level(tick)).hidden_quantity += info.hidden;
+        m_icebergs++;
+    }
+    if (record) record->order_id = order->id;
+    publish_levels();
+    return order->id;
+}
+
+uint64_t Orderbook::add_peg(PegType type, int qty, BookSide side, int offset_ticks, uint32_t owner) {
+    if (qty <= 0 || offset_ticks < 0) {
+        throw std::invalid_argument("Peg needs a positive quantity and a non-negative offset");
+    }
+    check_owner(owner);
+    LatencyScope timer(sample_latency(), LatencyOp::add);
+    reprice_pegs(); // brings the references up to date if nothing was pegged until now
+    // The target is worked out before a group is created, so a peg with nothing to peg to leaves none behind
+    size_t index = find_peg_group(type, side, offset_ticks);
+    const bool joins = index != LevelBitmap::npos && m_peg_groups[index].count != 0;
+    const size_t tick = joins ? m_peg_groups[index].tick
+                              : peg_target(PegGroup{type, side, offset_ticks, LevelBitmap::npos});
+    if (tick == LevelBitmap::npos) {
+        throw std::invalid_argument("No reference price to peg to");
+    }
+    if (index == LevelBitmap::npos) {
+        index = peg_group(type, side, offset_ticks);
+    }
+    PegGroup& group = m_peg_groups[index];
+    group.tick = tick;
+    journal_owner(owner);
+    JournalRecord* record = journal(JournalOp::peg, static_cast<uint8_t>(side), qty, Price::from_units(offset_ticks));
+    if (record) record->tif = static_cast<uint8_t>(type);
+
+    Order* order = add_order_at_tick(qty, group.tick, side, m_ids.next(), owner);
+    m_order_pool.info(order).peg = static_cast<uint32_t>(index + 1);
+    group.count++;
+    m_pegged++;
+    if (record) record->order_id = order->id;
+    publish_levels();
+    return order->id;
+}
+
+size_t Orderbook::find_peg_group(PegType type, BookSide side, int offset) const {
+    for (size_t i = 0; i < m_peg_groups.size(); ++i) {
+        const PegGroup& group = m_peg_groups[i];
+        if (group.type == type && group.side == side && group.offset == offset) {
+            return i;
+        }
+    }
+    return LevelBitmap::npos;
+}
+
+size_t Orderbook::peg_group(PegType type, BookSide side, int offset) {
+    if (const size_t i = find_peg_group(type, side, offset); i != LevelBitmap::npos) {
+        return i;
+    }
+    m_peg_groups.push_back(PegGroup{type, side, offset, LevelBitmap::npos});
+    return m_peg_groups.size() - 1;
+}
+
+// Best tick holding at least one order that is not pegged, npos if there is none. Pegs sit at no more ticks
+// than there are groups, so this looks at a handful of levels at most.
+template <typename Ladder>
+size_t Orderbook::unpegged_best(const Ladder& ladder, BookSide side) const {
+    for (size_t tick = ladder.best_tick(); tick != Ladder::npos; tick = ladder.next_worse(tick)) {
+        size_t pegged = 0;
+        for (const PegGroup& group : m_peg_groups) {
+            if (group.side == side && group.tick == tick) pegged += group.count;
+        }
+        if (ladder.level(tick).size() > pegged) {
+            return tick;
+        }
+    }
+    return Ladder::npos;
+}
+
+// Where the group belongs for the current references, npos while what it follows is missing or no tick is left
+// behind the opposite side's unpegged best
+size_t Orderbook::peg_target(const PegGroup& group) const {
+    const size_t bid = m_peg_ref_bid;
+    const size_t ask = m_peg_ref_ask;
+    const bool buy = group.side == BookSide::bid;
+    const bool two_sided = bid != LevelBitmap::npos && ask != LevelBitmap::npos && ask > bid;
+    // Innermost ticks each side may take. An even spread leaves its middle tick to neither, so pegs never cross.
+    const size_t inside = two_sided ? (ask - bid - 1) / 2 : 0;
+
+    size_t reference;
+    switch (group.type) {
+        case PegType::primary: reference = buy ? bid : ask; break;
+        case PegType::market: reference = buy ? ask : bid; break;
+        default: reference = !two_sided ? LevelBitmap::npos : buy ? bid + inside : ask - inside; break;
+    }
+    if (reference == LevelBitmap::npos) {
+        return LevelBitmap::npos;
+    }
+    long long target = static_cast<long long>(reference) + (buy ? -group.offset : group.offset);
+    if (two_sided) {
+        target = buy ? std::min<long long>(target, bid + inside) : std::max<long long>(target, ask - inside);
+    }
+    // Whatever the book looks like, a peg stays at least a tick behind the opposite touch and never locks it
+    if (buy && ask != LevelBitmap::npos) {
+        if (ask == 0) return LevelBitmap::npos;
+        target = std::min<long long>(target, static_cast<long long>(ask) - 1);
+    } else if (!buy && bid != LevelBitmap::npos) {
+        if (bid + 1 >= m_config.num_levels) return LevelBitmap::npos;
+        target = std::max<long long>(target, static_cast<long long>(bid) + 1);
+    }
+    return static_cast<size_t>(std::clamp<long long>(target, 0, m_config.num_levels - 1));
+}
+
+// Moves every group whose target changed, members in their current order to the back of the new level. Nothing
+// is journaled or allocated and ids stay, a replay reprices the same way.
+void Orderbook::reprice_pegs() {
+    const size_t bid = unpegged_best(m_bids, BookSide::bid);
+    const size_t ask = unpegged_best(m_asks, BookSide::ask);
+    if (bid == m_peg_ref_bid && ask == m_peg_ref_ask) {
+        return;
+    }
+    m_peg_ref_bid = bid;
+    m_peg_ref_ask = ask;
+
+    for (size_t i = 0; i < m_peg_groups.size(); ++i) {
+        PegGroup& group = m_peg_groups[i];
+        const size_t target = peg_target(group);
+        if (group.count == 0 || target == LevelBitmap::npos || target == group.tick) {
+            continue;
+        }
+        auto move = [&](auto& ladder) {
+            PriceLevel& from = ladder.level(group.tick);
+            const Price price = ladder.tick_to_price(target);
+            size_t moved = 0;
+            for (Order* order = from.front(); order != nullptr && moved < group.count;) {
+                Order* next = order->next;
+                OrderInfo& info = m_order_pool.info(order);
+                if (info.peg == i + 1) {
+                    from.unlink(order);
+                    ladder.push_back(target, order);
+                    info.price = price;
+                    info.tick = static_cast<uint32_t>(target);
+                    moved++;
+                }
+                order = next;
+            }
+            if (from.empty()) {
+                ladder.retire(group.tick);
+            }
+        };
+        if (group.side == BookSide::bid) {
+            move(m_bids);
+        } else {
+            move(m_asks);
+        }
+        touch(group.side, group.tick);
+        touch(group.side, target);
+        group.tick = target;
+    }
+}
+
+// Takes a filled or cancelled order out of its peg group, if it has one
+void Orderbook::unpeg(Order* order) {
+    OrderInfo& info = m_order_pool.info(order);
+    if (info.peg != 0) {
+        m_peg_groups[info.peg - 1].count--;
+        info.peg = 0;
+        m_pegged--;
+    }
+}
+
+// An iceberg whose displayed part just filled (and was popped) shows its next peak at the back of the level.
+// The order keeps its id and slot, so nothing is allocated. False for plain orders and spent icebergs.
+// Refills from one command share a timestamp, read on the first one.
+bool Orderbook::replenish(PriceLevel& level, Order* order, uint64_t& now) {
+    OrderInfo& info = m_order_pool.info(order);
+    if (info.hidden == 0) {
+        return false;
+    }
+    const int shown = std::min(info.peak, info.hidden);
+    info.hidden -= shown;
+    level.hidden_quantity -= shown;
+    if (info.hidden == 0) {
+        m_icebergs--;
     }
+    if (now == 0) now = unix_time();
+    info.timestamp = now;
+    order->quantity = shown;
+    level.push_back(order);
+    return true;
 }
 
-Orderbook::Orderbook(bool generate_dummies) {
+Orderbook::Orderbook(bool generate_dummies, const LadderConfig& config, size_t order_capacity, uint64_t id_space)
+    : m_config(config), m_bids(config), m_asks(config), m_order_pool(order_capacity), m_ids(id_space),
+      m_orders(id_space, order_capacity), m_touched_bids(config.num_levels), m_touched_asks(config.num_levels) {
+    m_filled_in_batch.reserve(order_capacity);
+
     // seed RNG (using fixed seed for reproducibility)
     srand(12);
 
     if (generate_dummies) {
         // Add some dummy bid orders
         for (int i = 0; i < 3; i++) {
-            double random_price = 90.0 + (rand() % 1001) / 100.0;
+            const Price random_price(90.0 + (rand() % 1001) / 100.0);
             int random_qty = rand() % 100 + 1;
             int random_qty2 = rand() % 100 + 1;
-            
+
             add_order(random_qty, random_price, BookSide::bid);
             this_thread::sleep_for(chrono::milliseconds(1)); // ensure different timestamps
             add_order(random_qty2, random_price, BookSide::bid);
         }
         // Add some dummy ask orders
         for (int i = 0; i < 3; i++) {
-            double random_price = 100.0 + (rand() % 1001) / 100.0;
+            const Price random_price(100.0 + (rand() % 1001) / 100.0);
             int random_qty = rand() % 100 + 1;
             int random_qty2 = rand() % 100 + 1;
-            
+
             add_order(random_qty, random_price, BookSide::ask);
             this_thread::sleep_for(chrono::milliseconds(1));
             add_order(random_qty2, random_price, BookSide::ask);
@@ -57,207 +300,694 @@ Orderbook::Orderbook(bool generate_dummies) {
     }
 }
 
-// Template function to fill orders from the offers (deque) at each price level
-template <typename T>
-std::pair<int, double> Orderbook::fill_order(map<double, deque<unique_ptr<Order>>, T>& offers, 
-                                               const OrderType type, const Side side, int& order_quantity,
-                                               const double price, int& units_transacted, double& total_value) {
-    // Iterate over the price levels (best prices first)
-    auto rit = offers.begin();
-    while(rit != offers.end()) {
-        const double price_level = rit->first;
-        auto& orders = rit->second;
+// A fully filled order leaves the index and returns to the pool, deferred to the end of a batch
+void Orderbook::release_filled(Order* order) {
+    if (m_in_batch) {
+        order->mark_filled();
+        m_filled_in_batch.push_back(order);
+    } else {
+        m_orders.erase(order->id);
+        m_order_pool.destroy(order);
+    }
+}
+
+// Resting order with this id, null if unknown or already filled in the current batch
+Order* Orderbook::find_live(uint64_t id) {
+    return const_cast<Order*>(find_order(id));
+}
+
+// Template function to fill orders from the offers ladder, best level first, reporting each match to the sink.
+// The side comes from the ladder and the order type is a template argument, so the loop carries one price check
+// for a limit order and none for a market order.
+template <OrderType Type, typename Ladder, typename Sink>
+std::pair<int, Notional> Orderbook::fill_order(Ladder& offers, int& order_quantity, const size_t limit_tick,
+                                               int& units_transacted, Notional& total_value, const uint64_t taker_id,
+                                               const uint32_t stp_owner, Sink& sink) {
+    constexpr Side taker_side = Ladder::side == BookSide::bid ? Side::sell : Side::buy;
+    uint64_t replenish_time = 0;
+
+    while (order_quantity > 0 && !offers.empty()) {
+        const size_t tick = offers.best_tick();
 
-        // For a limit order, ensure the price level is acceptable
+        // For a limit order, ensure the price level is acceptable, this is also the crossing check
         // market order always acceptable price
-        bool can_transact = true;
-        if (type == OrderType::limit) {
-            if (side == Side::buy && price_level > price) {
-                can_transact = false;
-            } else if (side == Side::sell && price_level < price) {
-                can_transact = false;
+        if constexpr (Type == OrderType::limit) {
+            if (!offers.is_marketable(tick, limit_tick)) {
+                break; // Prices will only get worse
             }
         }
 
-        if (can_transact) {
-            // Process orders at this price level while there are orders and the incoming order is not fully filled
-            while (!orders.empty() && order_quantity > 0) {
-                auto& current_order = orders.front();
-                const u_int64_t order_id = current_order->id;
-                int current_qty = current_order->quantity;
-                double current_price = current_order->price;
-
-                if (current_qty > order_quantity) { // Partial fill
-                    units_transacted += order_quantity;
-                    total_value += order_quantity * current_price;
-                    current_order->quantity = current_qty - order_quantity;
-                    order_quantity = 0;
-                    break; // Incoming order fully filled
-                } else { // Full fill
-                    units_transacted += current_qty;
-                    total_value += current_qty * current_price;
-                    order_quantity -= current_qty;
-                    orders.pop_front();
-                    // clean cache
-                    m_order_metadata.erase(order_id);
+        auto& orders = offers.level(tick);
+        const Price level_price = offers.tick_to_price(tick);
+        const int units_before = units_transacted;
+
+        // Process orders at this price level while there are orders and the incoming order is not fully filled
+        while (!orders.empty() && order_quantity > 0) {
+            Order* current_order = orders.front();
+            if (current_order->owner == stp_owner) [[unlikely]] {
+                // Read before the maker can go back to the pool
+                const uint64_t maker_id = current_order->id;
+                const int removed = prevent_self_trade(orders, current_order, order_quantity);
+                if (removed != 0) {
+                    const bool gone = orders.empty() || orders.front() != current_order;
+                    sink.on_self_trade_cancel(SelfTradeCancel{maker_id, taker_id, removed,
+                                                              gone ? 0 : current_order->quantity, Ladder::side,
+                                                              stp_owner});
                 }
+                touch(Ladder::side, tick);
+                continue;
             }
-            
-            // remove map entry if we wiped all the orders 
-            if (orders.empty()){
-                rit = offers.erase(rit);
-            }else{
-                if (order_quantity > 0) ++rit;
-                else break;
+            int current_qty = current_order->quantity;
+
+            if (current_qty > order_quantity) { // Partial fill
+                units_transacted += order_quantity;
+                orders.set_quantity(current_order, current_qty - order_quantity);
+                sink.on_execution(Execution{++m_execution_seq, current_order->id, taker_id, level_price,
+                                            order_quantity, current_order->quantity, 0, taker_side,
+                                            current_order->owner});
+                order_quantity = 0;
+                break; // Incoming order fully filled
+            } else { // Full fill
+                units_transacted += current_qty;
+                order_quantity -= current_qty;
+                orders.pop_front();
+                const bool replenished = m_icebergs != 0 && replenish(orders, current_order, replenish_time);
+                sink.on_execution(Execution{++m_execution_seq, current_order->id, taker_id, level_price, current_qty,
+                                            replenished ? current_order->quantity : 0, order_quantity, taker_side,
+                                            current_order->owner});
+                if (!replenished) {
+                    if (m_pegged != 0) unpeg(current_order);
+                    release_filled(current_order);
+                }
             }
-        }else{
-            // Prices will only get worse, break
-            break;
+        }
+
+        // Self-trade prevention can clear a level without trading at it
+        if (units_transacted != units_before) {
+            // One multiply per level, every fill here was at the same price
+            total_value.add(units_transacted - units_before, level_price);
+            touch(Ladder::side, tick);
+            m_last_trade_tick = tick;
+            m_trade_low = std::min(m_trade_low, tick);
+            m_trade_high = std::max(m_trade_high, tick);
+        }
+
+        // retire the level if we wiped all the orders
+        if (orders.empty()) {
+            offers.retire(tick);
         }
     }
-    
+
     return std::make_pair(units_transacted, total_value);
 }
 
 // Handles market and limit orders, returning the total units transacted and total value
-std::pair<int, double> Orderbook::handle_order(OrderType type, int order_quantity, Side side, double price) {
-    int units_transacted = 0;
-    double total_value = 0;
-
-    if (type == OrderType::market) {
-        if (side == Side::sell) {
-            return fill_order(m_bids, OrderType::market, Side::sell, order_quantity, price, units_transacted, total_value);
-        } else if (side == Side::buy) {
-            return fill_order(m_asks, OrderType::market, Side::buy, order_quantity, price, units_transacted, total_value);
-        }
-    } else if (type == OrderType::limit) {
-        if (side == Side::buy) {
-            if (best_quote(BookSide::ask) <= price) {
-                auto fill = fill_order(m_asks, OrderType::limit, Side::buy, order_quantity, price, units_transacted, total_value);
-                if (order_quantity > 0)
-                    add_order(order_quantity, price, BookSide::bid);
-                return fill;
-            } else {
-                add_order(order_quantity, price, BookSide::bid);
-                return std::make_pair(units_transacted, total_value);
+std::pair<int, Notional> Orderbook::handle_order(OrderType type, int order_quantity, Side side, Price price,
+                                               TimeInForce tif, uint32_t owner) {
+    NullExecutionSink sink;
+    return submit_order(type, order_quantity, side, price, tif, owner, sink);
+}
+
+std::pair<int, Notional> Orderbook::handle_order(OrderType type, int order_quantity, Side side, Price price,
+                                               ExecutionBuffer& executions, TimeInForce tif, uint32_t owner) {
+    return submit_order(type, order_quantity, side, price, tif, owner, executions);
+}
+
+template <typename Sink>
+std::pair<int, Notional> Orderbook::submit_order(OrderType type, int order_quantity, Side side, Price price,
+                                               TimeInForce tif, uint32_t owner, Sink& sink) {
+    LatencyScope timer(sample_latency(), type == OrderType::market ? LatencyOp::market : LatencyOp::limit);
+    m_last_resting_id = 0;
+    check_owner(owner);
+    journal_owner(owner);
+    JournalRecord* record = journal(type == OrderType::market ? JournalOp::market : JournalOp::limit,
+                                    static_cast<uint8_t>(side), order_quantity, price);
+    if (record) record->tif = static_cast<uint8_t>(tif);
+    m_trade_low = LevelBitmap::npos;
+    m_trade_high = 0;
+    auto fill = match_order(type, order_quantity, side, price, tif, sink, 0, owner);
+    if (m_stops && !m_stops->empty() && m_trade_low != LevelBitmap::npos) {
+        // The command reports its own resting id, not one a triggered stop-limit left behind
+        const uint64_t resting_id = m_last_resting_id;
+        run_stops(sink);
+        m_last_resting_id = resting_id;
+    }
+    if (record) record->order_id = m_last_resting_id;
+    publish_levels();
+    return fill;
+}
+
+// Fires stops one at a time until none is left inside the traded range. Each one enters the book under its own
+// id, and its trades widen the range before the next check, so cascades resolve in a fixed order. Limit prices
+// were checked when the stop was added, so anything thrown here (such as an allocation failure) is a real error
+// and goes to the caller.
+template <typename Sink>
+void Orderbook::run_stops(Sink& sink) {
+    PendingStop stop;
+    while (m_stops->pop_triggered(m_trade_low, m_trade_high, stop)) {
+        match_order(stop.type, stop.quantity, stop.side, stop.limit_price, TimeInForce::gtc, sink, stop.id,
+                    stop.owner);
+    }
+}
+
+uint64_t Orderbook::add_stop(OrderType type, int qty, Side side, Price trigger_price, Price limit_price,
+                             uint32_t owner) {
+    if (qty <= 0) {
+        throw std::invalid_argument("Stop needs a positive quantity");
+    }
+    check_owner(owner);
+    // Convert up front so an out of range price is rejected before anything is recorded
+    const size_t trigger_tick = m_bids.price_to_tick(trigger_price);
+    if (type == OrderType::limit) {
+        m_bids.limit_tick(limit_price, side == Side::buy ? BookSide::bid : BookSide::ask);
+    } else {
+        limit_price = Price{};
+    }
+    LatencyScope timer(sample_latency(), LatencyOp::add);
+    // Two records, the second one carries the limit price and the id
+    journal_owner(owner);
+    JournalRecord* trigger = journal(JournalOp::stop, static_cast<uint8_t>(side), qty, trigger_price);
+    if (trigger) trigger->tif = static_cast<uint8_t>(type);
+    JournalRecord* record = journal(JournalOp::stop_price, static_cast<uint8_t>(side), qty, limit_price);
+
+    const uint64_t id = m_ids.next();
+    if (record) record->order_id = id;
+    stops().add(PendingStop{id, side, type, qty, limit_price, trigger_tick, unix_time(), owner});
+
+    // A stop the last trade has already reached fires now
+    if (m_last_trade_tick != LevelBitmap::npos) {
+        m_trade_low = m_trade_high = m_last_trade_tick;
+        NullExecutionSink sink;
+        run_stops(sink);
+    }
+    publish_levels();
+    return id;
+}
+
+// Whether the levels a taker can reach hold at least quantity, iceberg reserves included, summed a level at a time
+// without visiting orders. A taker under self-trade prevention walks the orders instead: meeting its own before it
+// is filled kills it, except under cancel_oldest, where own orders are skipped.
+template <OrderType Type, typename Ladder>
+bool Orderbook::can_fill(const Ladder& offers, int quantity, size_t limit_tick, uint32_t owner) const {
+    int64_t available = 0;
+    for (size_t tick = offers.best_tick(); tick != Ladder::npos; tick = offers.next_worse(tick)) {
+        if constexpr (Type == OrderType::limit) {
+            if (!offers.is_marketable(tick, limit_tick)) {
+                break;
             }
-        } else { // Side::sell
-            if (best_quote(BookSide::bid) >= price) {
-                auto fill = fill_order(m_bids, OrderType::limit, Side::sell, order_quantity, price, units_transacted, total_value);
-                if (order_quantity > 0)
-                    add_order(order_quantity, price, BookSide::ask);
-                return fill;
-            } else {
-                add_order(order_quantity, price, BookSide::ask);
-                return std::make_pair(units_transacted, total_value);
+        }
+        const PriceLevel& level = offers.level(tick);
+        if (owner == Order::no_owner) {
+            available += level.total_quantity + level.hidden_quantity;
+        } else {
+            for (const Order& order : level) {
+                if (order.owner != owner) {
+                    available += order.quantity + m_order_pool.info(&order).hidden;
+                } else if (m_stp != StpMode::cancel_oldest) {
+                    return false;
+                }
+                if (available >= quantity) {
+                    return true;
+                }
             }
         }
-    } else {
+        if (available >= quantity) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The taker met a resting order of its own owner at the front of level. The taker is the newest of the two.
+int Orderbook::prevent_self_trade(PriceLevel& level, Order* maker, int& order_quantity) {
+    m_self_trades_prevented++;
+    // All of a dropped maker leaves, its iceberg reserve too
+    const int whole = maker->quantity + m_order_pool.info(maker).hidden;
+    switch (m_stp) {
+        case StpMode::cancel_newest:
+            order_quantity = 0;
+            return 0;
+        case StpMode::cancel_oldest:
+            drop_maker(level, maker);
+            return whole;
+        case StpMode::cancel_both:
+            drop_maker(level, maker);
+            order_quantity = 0;
+            return whole;
+        case StpMode::decrement: {
+            // A maker decremented to nothing goes, reserve and all
+            const int reduce = std::min(maker->quantity, order_quantity);
+            order_quantity -= reduce;
+            if (reduce == maker->quantity) {
+                drop_maker(level, maker);
+                return whole;
+            }
+            level.set_quantity(maker, maker->quantity - reduce);
+            return reduce;
+        }
+        case StpMode::none:
+            break; // no maker carries no_owner, so this is never reached
+    }
+    return 0;
+}
+
+// Cancels the maker at the front of level inside matching, the caller retires the level once it is empty
+void Orderbook::drop_maker(PriceLevel& level, Order* maker) {
+    level.pop_front();
+    const OrderInfo& info = m_order_pool.info(maker);
+    if (info.hidden != 0) {
+        level.hidden_quantity -= info.hidden;
+        m_icebergs--;
+    }
+    if (m_pegged != 0) unpeg(maker);
+    release_filled(maker);
+}
+
+// The incoming order gets its id up front, executions name it and a resting remainder keeps it. The kernel for
+// its side, type and time in force is picked once here, so none of the three is tested again while matching.
+template <typename Sink>
+std::pair<int, Notional> Orderbook::match_order(OrderType type, int order_quantity, Side side, Price price,
+                                              TimeInForce tif, Sink& sink, uint64_t taker_id, uint32_t owner) {
+    using Kernel = std::pair<int, Notional> (Orderbook::*)(int, Price, Sink&, uint64_t, uint32_t);
+    // Indexed [side][type][time in force]
+    static constexpr Kernel kernels[2][2][3] = {
+        {{&Orderbook::match_kernel<Side::buy, OrderType::market, TimeInForce::gtc, Sink>,
+          &Orderbook::match_kernel<Side::buy, OrderType::market, TimeInForce::ioc, Sink>,
+          &Orderbook::match_kernel<Side::buy, OrderType::market, TimeInForce::fok, Sink>},
+         {&Orderbook::match_kernel<Side::buy, OrderType::limit, TimeInForce::gtc, Sink>,
+          &Orderbook::match_kernel<Side::buy, OrderType::limit, TimeInForce::ioc, Sink>,
+          &Orderbook::match_kernel<Side::buy, OrderType::limit, TimeInForce::fok, Sink>}},
+        {{&Orderbook::match_kernel<Side::sell, OrderType::market, TimeInForce::gtc, Sink>,
+          &Orderbook::match_kernel<Side::sell, OrderType::market, TimeInForce::ioc, Sink>,
+          &Orderbook::match_kernel<Side::sell, OrderType::market, TimeInForce::fok, Sink>},
+         {&Orderbook::match_kernel<Side::sell, OrderType::limit, TimeInForce::gtc, Sink>,
+          &Orderbook::match_kernel<Side::sell, OrderType::limit, TimeInForce::ioc, Sink>,
+          &Orderbook::match_kernel<Side::sell, OrderType::limit, TimeInForce::fok, Sink>}}};
+
+    const auto s = static_cast<size_t>(side);
+    const auto t = static_cast<size_t>(type);
+    const auto f = static_cast<size_t>(tif);
+    if (s > 1 || t > 1 || f > 2) {
         throw std::runtime_error("Invalid order type encountered");
     }
-    return std::make_pair(units_transacted, total_value);
+    return (this->*kernels[s][t][f])(order_quantity, price, sink, taker_id, owner);
+}
+
+template <Side S, OrderType Type, TimeInForce Tif, typename Sink>
+std::pair<int, Notional> Orderbook::match_kernel(int order_quantity, Price price, Sink& sink, uint64_t taker_id,
+                                               uint32_t owner) {
+    int units_transacted = 0;
+    Notional total_value;
+    const uint32_t stp = stp_owner(owner);
+    auto& offers = [this]() -> auto& {
+        if constexpr (S == Side::buy) {
+            return m_asks;
+        } else {
+            return m_bids;
+        }
+    }();
+
+    // Convert up front so an out of range price is rejected before touching the book
+    size_t tick = 0;
+    if constexpr (Type == OrderType::limit) {
+        tick = m_bids.limit_tick(price, S == Side::buy ? BookSide::bid : BookSide::ask);
+    }
+    if constexpr (Tif == TimeInForce::fok) {
+        if (!can_fill<Type>(offers, order_quantity, tick, stp)) {
+            return std::make_pair(units_transacted, total_value);
+        }
+    }
+    if (taker_id == 0) {
+        taker_id = m_ids.next();
+    }
+
+    auto fill = fill_order<Type>(offers, order_quantity, tick, units_transacted, total_value, taker_id, stp, sink);
+    if constexpr (Type == OrderType::limit && Tif == TimeInForce::gtc) {
+        if (order_quantity > 0) {
+            add_order_at_tick(order_quantity, tick, S == Side::buy ? BookSide::bid : BookSide::ask, taker_id, owner);
+        }
+    }
+    return fill;
+}
+
+// Updates from one command share its number, commands that changed nothing do not use one up
+void Orderbook::publish_levels() {
+    // Pegs follow the touch the command left behind, and their moves go out with the rest of its updates
+    if (m_pegged != 0) {
+        reprice_pegs();
+    }
+    if (m_touched.empty()) {
+        return;
+    }
+    m_l2_command++;
+    if (m_l2) {
+        for (auto [side, tick] : m_touched) {
+            const PriceLevel& level = side == BookSide::bid ? m_bids.level(tick) : m_asks.level(tick);
+            m_l2->publish(LevelUpdate{m_l2_command, side, m_bids.tick_to_price(tick), level.total_quantity,
+                                      static_cast<uint32_t>(level.size())});
+        }
+    }
+    if (m_view) {
+        refresh_view();
+    }
+    for (auto [side, tick] : m_touched) {
+        (side == BookSide::bid ? m_touched_bids : m_touched_asks).reset(tick);
+    }
+    m_touched.clear();
 }
 
-// Returns the best quote (price) for the given book side
-double Orderbook::best_quote(BookSide side) {
+// Republishes the view if the command changed a level it shows, or one that now belongs in it; while a side
+// shows fewer than depth levels its edge lets everything through. A shown level that is still there is patched
+// in place, a side only walks its ladder again when a level appeared or emptied.
+void Orderbook::refresh_view(bool rewalk_all) {
+    bool changed = rewalk_all;
+    bool rewalk[2] = {rewalk_all, rewalk_all};
+    for (auto [side, tick] : m_touched) {
+        const bool bid = side == BookSide::bid;
+        if (bid ? tick < m_view_bid_edge : tick > m_view_ask_edge) {
+            continue;
+        }
+        changed = true;
+        if (rewalk[!bid]) {
+            continue;
+        }
+        const PriceLevel& level = bid ? m_bids.level(tick) : m_asks.level(tick);
+        DepthLevel* shown = bid ? m_view_snapshot.bids : m_view_snapshot.asks;
+        const uint32_t count = bid ? m_view_snapshot.bid_count : m_view_snapshot.ask_count;
+        uint32_t i = 0;
+        while (i < count && m_view_ticks[!bid][i] != tick) {
+            ++i;
+        }
+        if (i == count || level.empty()) {
+            rewalk[!bid] = true;
+        } else {
+            shown[i].quantity = level.total_quantity;
+            shown[i].count = static_cast<uint32_t>(level.size());
+        }
+    }
+    if (!changed) {
+        return;
+    }
+    if (rewalk[0]) {
+        const size_t edge = walk_view(m_bids, m_view_snapshot.bids, m_view_snapshot.bid_count, m_view_ticks[0]);
+        m_view_bid_edge = edge == LevelBitmap::npos ? 0 : edge;
+    }
+    if (rewalk[1]) {
+        m_view_ask_edge = walk_view(m_asks, m_view_snapshot.asks, m_view_snapshot.ask_count, m_view_ticks[1]);
+    }
+    m_view_snapshot.command = m_l2_command;
+    m_view->publish(m_view_snapshot);
+}
+
+// Copies the best depth levels of one side, returns the worst tick copied or npos if fewer than depth exist
+template <typename Ladder>
+size_t Orderbook::walk_view(const Ladder& ladder, DepthLevel* out, uint32_t& count, size_t* ticks) {
+    size_t last = LevelBitmap::npos;
+    count = 0;
+    for (size_t tick = ladder.best_tick(); tick != LevelBitmap::npos && count < BookView::depth;
+         tick = ladder.next_worse(tick)) {
+        const PriceLevel& level = ladder.level(tick);
+        ticks[count] = tick;
+        out[count++] = DepthLevel{ladder.tick_to_price(tick), level.total_quantity, static_cast<uint32_t>(level.size())};
+        last = tick;
+    }
+    return count == BookView::depth ? last : LevelBitmap::npos;
+}
+
+void Orderbook::set_book_view(BookView* view) {
+    m_view = view;
+    if (m_view) {
+        refresh_view(true);
+    }
+}
+
+size_t Orderbook::top_levels(BookSide side, std::span<DepthLevel> out) const {
+    auto copy = [&](const auto& ladder) {
+        size_t n = 0;
+        for (size_t tick = ladder.best_tick(); tick != LevelBitmap::npos && n < out.size();
+             tick = ladder.next_worse(tick)) {
+            const PriceLevel& level = ladder.level(tick);
+            out[n++] = DepthLevel{ladder.tick_to_price(tick), level.total_quantity, static_cast<uint32_t>(level.size())};
+        }
+        return n;
+    };
+    return side == BookSide::bid ? copy(m_bids) : copy(m_asks);
+}
+
+// Returns the best quote (price) for the given book side, 0 if that side is empty
+Price Orderbook::best_quote(BookSide side) {
     if (side == BookSide::bid) {
-        return m_bids.begin()->first;
+        return m_bids.empty() ? Price{} : m_bids.tick_to_price(m_bids.best_tick());
     } else if (side == BookSide::ask) {
-        return m_asks.begin()->first;
+        return m_asks.empty() ? Price{} : m_asks.tick_to_price(m_asks.best_tick());
     } else {
-        return 0.0;
+        return Price{};
     }
 }
 
-// Search through whole book and modify the target order
+// Modify the order in place, found directly through the id index
 bool Orderbook::modify_order(uint64_t id, int new_qty) {
-    auto [side, price] = m_order_metadata[id];
+    LatencyScope timer(sample_latency(), LatencyOp::modify);
+    journal(JournalOp::modify, 0, new_qty, Price{}, id);
+    Order* order = find_live(id);
+    if (order == nullptr) {
+        return false;
+    }
+    const OrderInfo& info = m_order_pool.info(order);
+    if (info.side == BookSide::bid) {
+        m_bids.level(info.tick).set_quantity(order, new_qty);
+    } else {
+        m_asks.level(info.tick).set_quantity(order, new_qty);
+    }
+    touch(info.side, info.tick);
+    publish_levels();
+    return true;
+}
 
-    auto modify_order_in_map = [&](auto& orders_map)->bool{
-        for (auto& o:orders_map[price]) {
-            if(o->id == id){
-                o->quantity = new_qty;
-                return true;
-            }
+// Unlink the order from its level in O(1) and retire the level if it emptied
+bool Orderbook::delete_order(uint64_t id) {
+    LatencyScope timer(sample_latency(), LatencyOp::cancel);
+    journal(JournalOp::cancel, 0, 0, Price{}, id);
+    Order* order = find_live(id);
+    if (order == nullptr) {
+        return m_stops && m_stops->cancel(id);
+    }
+
+    OrderInfo& info = m_order_pool.info(order);
+    auto remove_from_ladder = [&](auto& ladder) {
+        auto& orders = ladder.level(info.tick);
+        orders.unlink(order);
+        if (info.hidden != 0) {
+            orders.hidden_quantity -= info.hidden;
+            m_icebergs--;
+        }
+        if (orders.empty()) {
+            ladder.retire(info.tick);
         }
-        return false;
     };
 
-    if (side==BookSide::ask){
-        return modify_order_in_map(m_asks);
-    }else if (side==BookSide::bid){
-        return modify_order_in_map(m_bids);
-    }else{
-        return false;
+    const BookSide side = info.side;
+    if (side == BookSide::bid) {
+        remove_from_ladder(m_bids);
+    } else {
+        remove_from_ladder(m_asks);
     }
+    touch(side, info.tick);
+    if (m_pegged != 0) unpeg(order);
+    m_orders.erase(id);
+    m_order_pool.destroy(order);
+    publish_levels();
+    return true;
 }
 
-// Sweep through the book 
-bool Orderbook::delete_order(uint64_t id) {
-    auto [side, price] = m_order_metadata[id];
-    m_order_metadata.erase(id); // clean cache
-
-    auto remove_from_map = [&](auto& orders_map) -> bool {
-        // Iterate through orders of price level 
-        auto& orders = orders_map[price]; 
-        bool removed = false;
-
-        for(auto qit = orders.begin(); qit!=orders.end(); ){
-            if ((*qit)->id == id){
-                orders.erase(qit);
-                removed = true;
-                break;
+size_t Orderbook::memory_bytes() const {
+    return m_bids.memory_bytes() + m_asks.memory_bytes() + m_order_pool.memory_bytes() + m_orders.memory_bytes() +
+           m_touched_bids.memory_bytes() + m_touched_asks.memory_bytes() + (m_stops ? m_stops->memory_bytes() : 0);
+}
+
+void Orderbook::load_snapshot(const SnapshotReader& snapshot) {
+    const SnapshotHeader& header = snapshot.header();
+    if (!m_orders.empty() || pending_stops() != 0) {
+        throw std::logic_error("Snapshots can only be loaded into an empty book");
+    }
+    if (header.tick_size != m_config.tick_size || header.reference_price != m_config.reference_price ||
+        header.num_levels != m_config.num_levels) {
+        throw std::invalid_argument("Snapshot was taken with a different ladder");
+    }
+    if (!m_ids.owns(header.last_order_id)) {
+        throw std::invalid_argument("Snapshot was taken in a different id space");
+    }
+    std::span<const std::byte> body = snapshot.body();
+    size_t offset = 0;
+    auto read = [&](void* out, size_t bytes) {
+        if (offset + bytes > body.size()) {
+            throw std::runtime_error("Snapshot is truncated");
+        }
+        std::memcpy(out, body.data() + offset, bytes);
+        offset += bytes;
+    };
+
+    // Levels arrive best first with their FIFO in order, so appending rebuilds time priority as is
+    for (uint64_t l = 0; l < header.level_count; ++l) {
+        SnapshotLevel level;
+        read(&level, sizeof(level));
+        if (level.tick >= m_config.num_levels) {
+            throw std::runtime_error("Snapshot level outside of ladder range");
+        }
+        const BookSide side = static_cast<BookSide>(level.side);
+        const Price price = m_bids.tick_to_price(level.tick);
+
+        for (uint32_t i = 0; i < level.count; ++i) {
+            SnapshotOrder record;
+            read(&record, sizeof(record));
+            if (!m_ids.owns(record.id)) {
+                throw std::runtime_error("Snapshot order outside of the book's id space");
             }
-            qit++;
+            Order* order = m_order_pool.create_with_id(record.id, record.quantity, price, side, record.timestamp);
+            order->owner = record.owner;
+            m_order_pool.info(order).tick = level.tick;
+            if (side == BookSide::bid) {
+                m_bids.push_back(level.tick, order);
+            } else {
+                m_asks.push_back(level.tick, order);
+            }
+            m_orders.insert(record.id, order);
         }
+    }
 
-        // Check if we removed the last value in the queue
-        if(orders.empty()){
-            orders_map.erase(price);
+    for (uint64_t i = 0; i < header.iceberg_count; ++i) {
+        SnapshotIceberg record;
+        read(&record, sizeof(record));
+        Order* order = find_live(record.id);
+        if (order == nullptr) {
+            throw std::runtime_error("Snapshot iceberg refers to an unknown order");
         }
-        return removed;
+        OrderInfo& info = m_order_pool.info(order);
+        info.peak = record.peak;
+        info.hidden = record.hidden;
+        (info.side == BookSide::bid ? m_bids.level(info.tick) : m_asks.level(info.tick)).hidden_quantity +=
+            record.hidden;
+        m_icebergs++;
+    }
 
-    };
-    
-    if (side==BookSide::bid){
-        return remove_from_map(m_bids);         
-    }else if(side==BookSide::ask){
-        return remove_from_map(m_asks);
-    }else{
-        return false;
+    for (uint64_t i = 0; i < header.stop_count; ++i) {
+        SnapshotStop record;
+        read(&record, sizeof(record));
+        if (record.trigger_tick >= m_config.num_levels) {
+            throw std::runtime_error("Snapshot stop outside of ladder range");
+        }
+        if (!m_ids.owns(record.id)) {
+            throw std::runtime_error("Snapshot stop outside of the book's id space");
+        }
+        stops().add(PendingStop{record.id, static_cast<Side>(record.side), static_cast<OrderType>(record.type),
+                                record.quantity, record.limit_price, record.trigger_tick, record.timestamp,
+                                record.owner});
+    }
+    for (uint64_t i = 0; i < header.peg_count; ++i) {
+        SnapshotPeg record;
+        read(&record, sizeof(record));
+        Order* order = find_live(record.id);
+        if (order == nullptr) {
+            throw std::runtime_error("Snapshot peg refers to an unknown order");
+        }
+        OrderInfo& info = m_order_pool.info(order);
+        const size_t index = peg_group(static_cast<PegType>(record.type), info.side, record.offset);
+        m_peg_groups[index].tick = info.tick;
+        m_peg_groups[index].count++;
+        info.peg = static_cast<uint32_t>(index + 1);
+        m_pegged++;
+    }
+    m_last_trade_tick = header.last_trade_tick < m_config.num_levels ? header.last_trade_tick : LevelBitmap::npos;
+    m_stp = static_cast<StpMode>(header.stp_mode);
+    m_execution_seq = header.execution_seq;
+    m_ids.advance(header.last_order_id);
+}
+
+OrderEvent Orderbook::handle_command(const OrderCommand& cmd) {
+    NullExecutionSink sink;
+    return apply_command(cmd, sink);
+}
+
+OrderEvent Orderbook::handle_command(const OrderCommand& cmd, ExecutionBuffer& executions) {
+    return apply_command(cmd, executions);
+}
+
+template <typename Sink>
+OrderEvent Orderbook::apply_command(const OrderCommand& cmd, Sink& sink) {
+    OrderEvent event;
+    event.seq = cmd.seq;
+    event.timestamp = cmd.timestamp;
+    event.order_id = cmd.order_id;
+    event.symbol = cmd.symbol;
+
+    try {
+        if (cmd.type == CommandType::new_order) {
+            auto [units, value] = submit_order(cmd.order_type, cmd.quantity, cmd.side, cmd.price, cmd.tif, cmd.owner,
+                                               sink);
+            const bool killed = cmd.tif == TimeInForce::fok && units == 0 && cmd.quantity > 0;
+            event.type = killed ? EventType::reject : units > 0 ? EventType::fill : EventType::ack;
+            event.units = units;
+            event.value = value;
+            event.order_id = m_last_resting_id;
+        } else if (cmd.type == CommandType::cancel) {
+            event.type = delete_order(cmd.order_id) ? EventType::ack : EventType::reject;
+        } else if (cmd.type == CommandType::modify) {
+            event.type = modify_order(cmd.order_id, cmd.quantity) ? EventType::ack : EventType::reject;
+        }
+    } catch (const std::exception&) {
+        event.type = EventType::reject;
     }
+    return event;
+}
+
+void Orderbook::handle_orders(std::span<const OrderCommand> commands, FillSink& sink) {
+    NullExecutionSink executions;
+    apply_batch(commands, sink, executions);
+}
+
+void Orderbook::handle_orders(std::span<const OrderCommand> commands, FillSink& sink, ExecutionBuffer& executions) {
+    apply_batch(commands, sink, executions);
 }
 
-// Template function to print a leg (bid or ask) of the order book.
-template<typename T>
-void Orderbook::print_leg(map<double, deque<unique_ptr<Order>>, T>& hashmap, BookSide side) {
+// Levels are still retired as soon as they empty, so the best level is never stale mid-batch.
+// What is deferred is the index erase and pool release of filled orders: one pass at the end.
+template <typename Sink>
+void Orderbook::apply_batch(std::span<const OrderCommand> commands, FillSink& events, Sink& sink) {
+    m_in_batch = true;
+    for (const OrderCommand& cmd : commands) {
+        events.push(apply_command(cmd, sink));
+    }
+    m_in_batch = false;
+
+    for (Order* order : m_filled_in_batch) {
+        m_orders.erase(order->id);
+        m_order_pool.destroy(order);
+    }
+    m_filled_in_batch.clear();
+}
+
+// Template function to print a leg (bid or ask) of the order book, highest price first.
+template<typename Ladder>
+void Orderbook::print_leg(Ladder& ladder, BookSide side) {
+    string color = side == BookSide::ask ? "31" : "32"; // red for asks, green for bids
+
+    auto print_level = [&](size_t tick) {
+        const int64_t size_sum = ladder.level(tick).total_quantity;
+        cout << "\t\033[1;" << color << "m" << "$" << setw(6) << fixed << setprecision(2)
+             << ladder.tick_to_price(tick).to_double() << setw(5) << size_sum << "\033[0m ";
+        for (int i = 0; i < size_sum / 10; i++) {
+            cout << "█";
+        }
+        cout << "\n";
+    };
+
     if (side == BookSide::ask) {
-        for (auto it = hashmap.rbegin(); it != hashmap.rend(); ++it) { // iterate over price levels
-            int size_sum = 0;
-            for (auto& order : it->second) {
-                size_sum += order->quantity;
-            }
-            string color = "31"; // red for asks
-            cout << "\t\033[1;" << color << "m" << "$" << setw(6) << fixed << setprecision(2)
-                 << it->first << setw(5) << size_sum << "\033[0m ";
-            for (int i = 0; i < size_sum / 10; i++) {
-                cout << "█";
-            }
-            cout << "\n";
+        for (size_t tick = ladder.worst_tick(); tick != Ladder::npos; tick = ladder.next_better(tick)) {
+            print_level(tick);
         }
     } else if (side == BookSide::bid) {
-        for (auto it = hashmap.begin(); it != hashmap.end(); ++it) {
-            int size_sum = 0;
-            for (auto& order : it->second) {
-                size_sum += order->quantity;
-            }
-            string color = "32"; // green for bids
-            cout << "\t\033[1;" << color << "m" << "$" << setw(6) << fixed << setprecision(2)
-                 << it->first << setw(5) << size_sum << "\033[0m ";
-            for (int i = 0; i < size_sum / 10; i++) {
-                cout << "█";
-            }
-            cout << "\n";
+        for (size_t tick = ladder.best_tick(); tick != Ladder::npos; tick = ladder.next_worse(tick)) {
+            print_level(tick);
         }
     }
 }
@@ -267,8 +997,8 @@ void Orderbook::print() {
     print_leg(m_asks, BookSide::ask);
 
     // Print bid-ask spread (in basis points)
-    double best_ask = best_quote(BookSide::ask);
-    double best_bid = best_quote(BookSide::bid);
+    double best_ask = best_quote(BookSide::ask).to_double();
+    double best_bid = best_quote(BookSide::bid).to_double();
     cout << "\n\033[1;33m" << "======  " << 10000 * (best_ask - best_bid) / best_bid << "bps  ======\033[0m\n\n";
 
     print_leg(m_bids, BookSide::bid);
@@ -0,0 +1,159 @@
+/**
+ * @file replay.cpp
+ * @brief Rebuilds an Orderbook from a binary journal (and optionally a snapshot) and reports throughput.
+ *
+ * Usage:
+ *   ./replay <journal>                          replay a journal and print the rebuilt book's summary
+ *   ./replay <journal> <snapshot>               restart: load the snapshot, then replay the journal past it
+ *   ./replay generate <journal> [num_orders] [snapshot]
+ *                                               record a random add/limit/market/modify/delete flow (default 10M),
+ *                                               snapshotting the live book in the background halfway through
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/helpers.hpp"
+#include "../include/journal.hpp"
+#include "../include/orderbook.hpp"
+#include "../include/snapshot.hpp"
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+void print_summary(Orderbook& book) {
+    cout << "Best bid " << book.best_quote(BookSide::bid) << ", best ask " << book.best_quote(BookSide::ask)
+         << ", " << book.get_bids().size() << " bid levels, " << book.get_asks().size() << " ask levels, "
+         << book.order_pool_stats().in_use << " resting orders\n";
+}
+
+// The fork is all the matching thread pays, the child writes the copy-on-write image while it carries on
+pid_t start_snapshot(const Orderbook& book, const string& path) {
+    uint64_t start_t = unix_time();
+    pid_t writer = snapshot_in_background(book, path);
+    cout << "Snapshot of " << book.order_pool_stats().in_use << " orders at journal position "
+         << book.journal_position() << ", fork took " << (unix_time() - start_t) / 1e6 << " ms\n";
+    return writer;
+}
+
+void finish_snapshot(pid_t writer, const string& path) {
+    if (!wait_for_snapshot(writer)) {
+        cerr << "Snapshot writer failed\n";
+        return;
+    }
+    SnapshotReader snapshot(path);
+    struct stat st;
+    ::stat(path.c_str(), &st);
+    uint64_t orders = std::max<uint64_t>(snapshot.header().order_count, 1);
+    cout << "Snapshot is " << st.st_size << " bytes, " << st.st_size * 1e6 / orders / (1 << 20)
+         << " MiB per million orders\n";
+}
+
+void generate(const string& path, size_t num_orders, const string& snapshot_path) {
+    Orderbook book(false);
+    Journal journal(path, LadderConfig{});
+    book.set_journal(&journal);
+
+    mt19937 rng(42);
+    uniform_int_distribution<int> qty_dist(1, 100);
+    uniform_int_distribution<int> tick_dist(1, 200);
+    vector<uint64_t> ids;
+    pid_t writer = -1;
+
+    uint64_t start_t = unix_time();
+    for (size_t i = 0; i < num_orders; ++i) {
+        if (i == num_orders / 2 && !snapshot_path.empty()) {
+            writer = start_snapshot(book, snapshot_path);
+        }
+        int action = rng() % 10;
+        bool buy = rng() & 1;
+        int qty = qty_dist(rng);
+        const double decimal = buy ? 100.0 - tick_dist(rng) / 100.0 : 100.0 + tick_dist(rng) / 100.0;
+        const Price price(decimal);
+
+        if (action < 3) {
+            ids.push_back(book.add_order(qty, price, buy ? BookSide::bid : BookSide::ask));
+        } else if (action < 5) {
+            // Crosses the spread by a few ticks now and then
+            const Price through(buy ? decimal + 1.0 : decimal - 1.0);
+            book.handle_order(OrderType::limit, qty, buy ? Side::buy : Side::sell, through);
+            if (book.last_resting_id() != 0) ids.push_back(book.last_resting_id());
+        } else if (action < 7) {
+            book.handle_order(OrderType::market, qty, buy ? Side::buy : Side::sell);
+        } else if (action < 8 && !ids.empty()) {
+            book.modify_order(ids[rng() % ids.size()], qty);
+        } else if (!ids.empty()) {
+            // Swap-remove so the id list does not grow without bound
+            size_t pick = rng() % ids.size();
+            book.delete_order(ids[pick]);
+            ids[pick] = ids.back();
+            ids.pop_back();
+        }
+    }
+    uint64_t end_t = unix_time();
+
+    cout << "Recorded " << journal.size() << " commands in " << (end_t - start_t) / 1e6 << " ms\n";
+    print_summary(book);
+    if (writer > 0) {
+        finish_snapshot(writer, snapshot_path);
+    }
+}
+
+// A restarted book holds about as many orders as the snapshot, sized so the pool stays one slab
+size_t capacity_for(uint64_t orders) {
+    return std::max<size_t>(Orderbook::default_order_capacity, orders + orders / 4);
+}
+
+void replay_rest(const JournalReader& journal, Orderbook& book, size_t first_record, uint64_t preloaded_through) {
+    uint64_t start_t = unix_time();
+    size_t applied = replay_journal(journal, book, first_record, preloaded_through);
+    uint64_t end_t = unix_time();
+
+    double seconds = (end_t - start_t) / 1e9;
+    cout << "Replayed " << applied << " commands in " << seconds * 1e3 << " ms ("
+         << static_cast<uint64_t>(applied / seconds) << " orders/s)\n";
+}
+
+void replay(const string& path) {
+    JournalReader journal(path);
+    Orderbook book(false, journal.ladder(), Orderbook::default_order_capacity);
+    replay_rest(journal, book, 0, 0);
+    print_summary(book);
+}
+
+void restart(const string& journal_path, const string& snapshot_path) {
+    JournalReader journal(journal_path);
+    SnapshotReader snapshot(snapshot_path);
+    const SnapshotHeader& header = snapshot.header();
+    Orderbook book(false, snapshot.ladder(), capacity_for(header.order_count));
+
+    uint64_t start_t = unix_time();
+    book.load_snapshot(snapshot);
+    uint64_t end_t = unix_time();
+    cout << "Loaded " << header.order_count << " orders on " << header.level_count << " levels in "
+         << (end_t - start_t) / 1e6 << " ms\n";
+
+    replay_rest(journal, book, header.journal_position, header.last_order_id);
+    print_summary(book);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && string(argv[1]) == "generate") {
+        size_t num_orders = argc >= 4 ? stoull(argv[3]) : 10'000'000;
+        generate(argv[2], num_orders, argc >= 5 ? argv[4] : "");
+    } else if (argc == 3) {
+        restart(argv[1], argv[2]);
+    } else if (argc == 2) {
+        replay(argv[1]);
+    } else {
+        cerr << "Usage: " << argv[0] << " <journal> [snapshot] | generate <journal> [num_orders] [snapshot]\n";
+        return 1;
+    }
+    return 0;
+}
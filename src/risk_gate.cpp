@@ -0,0 +1,162 @@
+/**
+ * @file risk_gate.cpp
+ * @brief This file contains the implementation of the RiskGate checks and exposure bookkeeping.
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include "../include/risk_gate.hpp"
+
+RiskGate::RiskGate(Orderbook& book, const RiskConfig& config)
+    : m_book(book), m_config(config), m_accounts(config.max_accounts) {
+    for (AccountRisk& account : m_accounts) {
+        account.limits = config.default_limits;
+    }
+}
+
+RiskReject RiskGate::check(OrderType type, int quantity, Side side, Price price, TimeInForce tif,
+                           uint32_t account) {
+    if (quantity <= 0) {
+        return RiskReject::bad_quantity;
+    }
+    if (quantity > m_config.max_order_quantity) {
+        return RiskReject::too_large;
+    }
+    if (account == 0 || account >= m_accounts.size()) {
+        return RiskReject::unknown_account;
+    }
+    const bool buy = side == Side::buy;
+    if (type == OrderType::limit) {
+        // Price::invalid() is negative, so decimals that did not convert are caught here too
+        if (price.units <= 0) {
+            return RiskReject::bad_price;
+        }
+        Price reference = m_book.best_quote(buy ? BookSide::ask : BookSide::bid);
+        if (reference == Price{}) {
+            reference = m_book.best_quote(buy ? BookSide::bid : BookSide::ask);
+        }
+        if (reference != Price{} &&
+            static_cast<double>(std::abs(price.units - reference.units)) > reference.units * m_config.collar) {
+            return RiskReject::outside_collar;
+        }
+    }
+
+    const AccountRisk& risk = m_accounts[account];
+    const int64_t open = buy ? risk.open_buy : risk.open_sell;
+    // Only a GTC limit can rest, anything else leaves open exposure where it is
+    if (type == OrderType::limit && tif == TimeInForce::gtc && open + quantity > risk.limits.max_open) {
+        return RiskReject::open_limit;
+    }
+    const int64_t worst = buy ? risk.position + open + quantity : -risk.position + open + quantity;
+    if (worst > risk.limits.max_position) {
+        return RiskReject::position_limit;
+    }
+    return RiskReject::none;
+}
+
+GateResult RiskGate::submit(OrderType type, int quantity, Side side, Price price, uint32_t account,
+                            TimeInForce tif) {
+    GateResult result;
+    result.reject = check(type, quantity, side, price, tif, account);
+    if (!result.accepted()) {
+        return result;
+    }
+
+    m_executions.clear();
+    try {
+        auto [units, value] = m_book.handle_order(type, quantity, side, price, m_executions, tif, account);
+        result.units = units;
+        result.value = value;
+    } catch (const std::out_of_range&) {
+        result.reject = RiskReject::bad_price; // off the ladder
+        return result;
+    }
+    apply_executions(account);
+
+    result.order_id = m_book.last_resting_id();
+    if (result.order_id != 0) {
+        // Only decrement prevention shrinks a taker without a fill, otherwise the remainder is known without a lookup
+        const int resting = m_book.self_trade_prevention() == StpMode::decrement
+                                ? m_book.find_order(result.order_id)->quantity
+                                : quantity - result.units;
+        AccountRisk& risk = m_accounts[account];
+        (side == Side::buy ? risk.open_buy : risk.open_sell) += resting;
+    }
+    return result;
+}
+
+// The taker's position moves by each of its fills. Each maker's moves the other way, and its fill leaves its open
+// side. The command's own order trades first, later executions belong to stops it triggered, which are not gated.
+// Makers outside the gated range change nothing. A maker self-trade prevention took quantity off leaves its open
+// side by that much without moving its position.
+void RiskGate::apply_executions(uint32_t taker) {
+    for (const SelfTradeCancel& cancel : m_executions.self_trade_cancels()) {
+        if (cancel.maker_owner != 0 && cancel.maker_owner < m_accounts.size()) {
+            AccountRisk& maker = m_accounts[cancel.maker_owner];
+            (cancel.maker_side == BookSide::bid ? maker.open_buy : maker.open_sell) -= cancel.quantity;
+        }
+    }
+    auto executions = m_executions.executions();
+    if (executions.empty()) {
+        return;
+    }
+    const uint64_t taker_id = executions[0].taker_id;
+    for (const Execution& execution : executions) {
+        const bool buy = execution.taker_side == Side::buy;
+        const int64_t signed_quantity = buy ? execution.quantity : -execution.quantity;
+        if (execution.taker_id == taker_id) {
+            m_accounts[taker].position += signed_quantity;
+        }
+        if (execution.maker_owner != 0 && execution.maker_owner < m_accounts.size()) {
+            AccountRisk& maker = m_accounts[execution.maker_owner];
+            maker.position -= signed_quantity;
+            (buy ? maker.open_sell : maker.open_buy) -= execution.quantity;
+        }
+    }
+}
+
+RiskReject RiskGate::modify(uint32_t account, uint64_t id, int new_quantity) {
+    if (new_quantity <= 0) {
+        return RiskReject::bad_quantity;
+    }
+    if (account == 0 || account >= m_accounts.size()) {
+        return RiskReject::unknown_account;
+    }
+    const Order* order = m_book.find_order(id);
+    if (order == nullptr || order->owner != account) {
+        return RiskReject::unknown_order;
+    }
+    const int delta = new_quantity - order->quantity;
+    AccountRisk& risk = m_accounts[account];
+    const bool buy = m_book.order_info(order).side == BookSide::bid;
+    int64_t& open = buy ? risk.open_buy : risk.open_sell;
+    if (delta > 0) {
+        if (new_quantity > m_config.max_order_quantity) {
+            return RiskReject::too_large;
+        }
+        if (open + delta > risk.limits.max_open) {
+            return RiskReject::open_limit;
+        }
+        if ((buy ? risk.position : -risk.position) + open + delta > risk.limits.max_position) {
+            return RiskReject::position_limit;
+        }
+    }
+    m_book.modify_order(id, new_quantity);
+    open += delta;
+    return RiskReject::none;
+}
+
+RiskReject RiskGate::cancel(uint32_t account, uint64_t id) {
+    if (account == 0 || account >= m_accounts.size()) {
+        return RiskReject::unknown_account;
+    }
+    const Order* order = m_book.find_order(id);
+    if (order == nullptr || order->owner != account) {
+        return RiskReject::unknown_order;
+    }
+    AccountRisk& risk = m_accounts[account];
+    (m_book.order_info(order).side == BookSide::bid ? risk.open_buy : risk.open_sell) -= order->quantity;
+    m_book.delete_order(id);
+    return RiskReject::none;
+}
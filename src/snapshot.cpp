@@ -0,0 +1,234 @@
+/**
+ * @file snapshot.cpp
+ * @brief This file contains the snapshot writer, the background snapshot fork and SnapshotReader.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../include/orderbook.hpp"
+#include "../include/snapshot.hpp"
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'O', 'B', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t snapshot_version = 8;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Fixed buffer in front of write(2). It never touches the heap, so it is safe in a forked child.
+class FdWriter {
+private:
+    int m_fd;
+    size_t m_used = 0;
+    bool m_ok = true;
+    std::byte m_buffer[1 << 16];
+
+public:
+    explicit FdWriter(int fd) : m_fd(fd) {}
+
+    void write(const void* data, size_t bytes) {
+        if (m_used + bytes > sizeof(m_buffer)) {
+            flush();
+        }
+        std::memcpy(m_buffer + m_used, data, bytes);
+        m_used += bytes;
+    }
+
+    bool flush() {
+        size_t done = 0;
+        while (m_ok && done < m_used) {
+            ssize_t n = ::write(m_fd, m_buffer + done, m_used - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) m_ok = false;
+            else done += static_cast<size_t>(n);
+        }
+        m_used = 0;
+        return m_ok;
+    }
+};
+
+template <typename Ladder>
+void write_side(const Orderbook& book, const Ladder& ladder, BookSide side, FdWriter& out) {
+    for (size_t tick = ladder.best_tick(); tick != Ladder::npos; tick = ladder.next_worse(tick)) {
+        const PriceLevel& level = ladder.level(tick);
+        SnapshotLevel record{static_cast<uint32_t>(tick), static_cast<uint8_t>(side), {},
+                             static_cast<uint32_t>(level.size())};
+        out.write(&record, sizeof(record));
+        for (const Order& order : level) {
+            SnapshotOrder entry{order.id, book.order_info(&order).timestamp, order.quantity, order.owner};
+            out.write(&entry, sizeof(entry));
+        }
+    }
+}
+
+template <typename Ladder>
+void write_icebergs(const Orderbook& book, const Ladder& ladder, FdWriter& out) {
+    for (size_t tick = ladder.best_tick(); tick != Ladder::npos; tick = ladder.next_worse(tick)) {
+        if (ladder.level(tick).hidden_quantity == 0) continue;
+        for (const Order& order : ladder.level(tick)) {
+            const OrderInfo& info = book.order_info(&order);
+            if (info.hidden != 0) {
+                SnapshotIceberg entry{order.id, info.peak, info.hidden};
+                out.write(&entry, sizeof(entry));
+            }
+        }
+    }
+}
+
+template <typename Ladder>
+void write_pegs(const Orderbook& book, const Ladder& ladder, FdWriter& out) {
+    for (size_t tick = ladder.best_tick(); tick != Ladder::npos; tick = ladder.next_worse(tick)) {
+        for (const Order& order : ladder.level(tick)) {
+            const OrderInfo& info = book.order_info(&order);
+            if (info.peg != 0) {
+                const PegGroup& group = book.peg_group_of(info);
+                SnapshotPeg entry{order.id, group.offset, static_cast<uint8_t>(group.type), {}};
+                out.write(&entry, sizeof(entry));
+            }
+        }
+    }
+}
+
+// Orders and icebergs on one side
+template <typename Ladder>
+std::pair<uint64_t, uint64_t> count_orders(const Orderbook& book, const Ladder& ladder) {
+    uint64_t count = 0;
+    uint64_t icebergs = 0;
+    for (size_t tick = ladder.best_tick(); tick != Ladder::npos; tick = ladder.next_worse(tick)) {
+        const PriceLevel& level = ladder.level(tick);
+        count += level.size();
+        if (level.hidden_quantity == 0) continue;
+        for (const Order& order : level) {
+            icebergs += book.order_info(&order).hidden != 0;
+        }
+    }
+    return {count, icebergs};
+}
+
+// Writes tmp_path, syncs it and renames it over path so readers never see a partial snapshot
+bool write_file(const Orderbook& book, const char* tmp_path, const char* path) {
+    int fd = ::open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const LadderConfig& ladder = book.ladder_config();
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.num_levels = ladder.num_levels;
+    header.tick_size = ladder.tick_size;
+    header.reference_price = ladder.reference_price;
+    header.last_order_id = book.last_order_id();
+    header.execution_seq = book.execution_seq();
+    header.journal_position = book.journal_position();
+    auto [bid_orders, bid_icebergs] = count_orders(book, book.get_bids());
+    auto [ask_orders, ask_icebergs] = count_orders(book, book.get_asks());
+    header.order_count = bid_orders + ask_orders;
+    header.iceberg_count = bid_icebergs + ask_icebergs;
+    header.level_count = book.get_bids().size() + book.get_asks().size();
+    header.stop_count = book.pending_stops();
+    header.last_trade_tick = book.last_trade_tick();
+    header.peg_count = book.pegged_orders();
+    header.stp_mode = static_cast<uint8_t>(book.self_trade_prevention());
+
+    FdWriter out(fd);
+    out.write(&header, sizeof(header));
+    write_side(book, book.get_bids(), BookSide::bid, out);
+    write_side(book, book.get_asks(), BookSide::ask, out);
+    write_icebergs(book, book.get_bids(), out);
+    write_icebergs(book, book.get_asks(), out);
+    if (const TriggerBook* stops = book.trigger_book()) {
+        stops->for_each([&](const PendingStop& stop) {
+            SnapshotStop entry{stop.id, stop.timestamp, stop.limit_price, static_cast<uint32_t>(stop.trigger_tick),
+                               stop.quantity, static_cast<uint8_t>(stop.side), static_cast<uint8_t>(stop.type), {},
+                               stop.owner};
+            out.write(&entry, sizeof(entry));
+        });
+    }
+    if (book.pegged_orders() != 0) {
+        write_pegs(book, book.get_bids(), out);
+        write_pegs(book, book.get_asks(), out);
+    }
+    bool ok = out.flush() && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    return ok && ::rename(tmp_path, path) == 0;
+}
+
+}
+
+void write_snapshot(const Orderbook& book, const std::string& path) {
+    const std::string tmp_path = path + ".tmp";
+    if (!write_file(book, tmp_path.c_str(), path.c_str())) {
+        throw_errno("Unable to write snapshot " + path);
+    }
+}
+
+pid_t snapshot_in_background(const Orderbook& book, const std::string& path) {
+    // Built before forking, the child only uses async-signal-safe calls and the stack
+    const std::string tmp_path = path + ".tmp";
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        throw_errno("Unable to fork snapshot writer");
+    }
+    if (pid == 0) {
+        ::_exit(write_file(book, tmp_path.c_str(), path.c_str()) ? 0 : 1);
+    }
+    return pid;
+}
+
+bool wait_for_snapshot(pid_t pid) {
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+SnapshotReader::SnapshotReader(const std::string& path) {
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        throw_errno("Unable to open snapshot " + path);
+    }
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        ::close(m_fd);
+        throw_errno("Unable to stat snapshot " + path);
+    }
+    m_file_size = static_cast<size_t>(st.st_size);
+    if (m_file_size < sizeof(SnapshotHeader)) {
+        ::close(m_fd);
+        throw std::runtime_error("Snapshot " + path + " is truncated");
+    }
+
+    void* data = ::mmap(nullptr, m_file_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(m_fd);
+        throw_errno("Unable to map snapshot " + path);
+    }
+    m_data = static_cast<const std::byte*>(data);
+    ::madvise(data, m_file_size, MADV_SEQUENTIAL);
+
+    std::memcpy(&m_header, m_data, sizeof(m_header));
+    if (std::memcmp(m_header.magic, snapshot_magic, sizeof(m_header.magic)) != 0 ||
+        m_header.version != snapshot_version) {
+        ::munmap(data, m_file_size);
+        ::close(m_fd);
+        throw std::runtime_error("Snapshot " + path + " has an unsupported format");
+    }
+}
+
+SnapshotReader::~SnapshotReader() {
+    ::munmap(const_cast<std::byte*>(m_data), m_file_size);
+    ::close(m_fd);
+}
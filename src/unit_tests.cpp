@@ -1,8 +1,25 @@
 #include <iostream>
 #include <cassert>
+#include <cmath>
+#include <vector>
 #include "../include/order.hpp"
 #include "../include/helpers.hpp"
 #include "../include/orderbook.hpp"
+#include "../include/spsc_ring.hpp"
+#include "../include/order_gateway.hpp"
+#include "../include/matching_engine.hpp"
+#include "../include/journal.hpp"
+#include "../include/snapshot.hpp"
+#include "../include/latency_histogram.hpp"
+#include "../include/mbo_feed.hpp"
+#include "../include/risk_gate.hpp"
+#include "../include/flat_id_map.hpp"
+#include "../include/map_orderbook.hpp"
+#include <atomic>
+#include <random>
+#include <thread>
+#include <cstdio>
+#include <unordered_map>
 
 using namespace std;
 
@@ -11,8 +28,8 @@ void test_add_order() {
     Orderbook orderbook(false);
 
     // Add one bid order and one ask order
-    orderbook.add_order(100, 100.50, BookSide::bid);
-    orderbook.add_order(200, 101.00, BookSide::ask);
+    orderbook.add_order(100, Price(100.50), BookSide::bid);
+    orderbook.add_order(200, Price(101.00), BookSide::ask);
 
     // Use getter functions to access bids and asks
     const auto& bids = orderbook.get_bids();
@@ -20,15 +37,15 @@ void test_add_order() {
 
     // Check if the bid order was added correctly
     assert(bids.size() == 1);                   // Only one price level in bids
-    assert(bids.at(100.50).size() == 1);          // One order at price 100.50
-    assert(bids.at(100.50)[0]->quantity == 100);  // Order quantity is 100
-    assert(bids.at(100.50)[0]->price == 100.50);   // Order price is 100.50
+    assert(bids.at(Price(100.50)).size() == 1);          // One order at price 100.50
+    assert(bids.at(Price(100.50))[0]->quantity == 100);  // Order quantity is 100
+    assert(orderbook.order_info(bids.at(Price(100.50))[0]).price == Price(100.50));   // Order price is 100.50
 
     // Check if the ask order was added correctly
     assert(asks.size() == 1);                   // Only one price level in asks
-    assert(asks.at(101.00).size() == 1);          // One order at price 101.00
-    assert(asks.at(101.00)[0]->quantity == 200);  // Order quantity is 200
-    assert(asks.at(101.00)[0]->price == 101.00);   // Order price is 101.00
+    assert(asks.at(Price(101.00)).size() == 1);          // One order at price 101.00
+    assert(asks.at(Price(101.00))[0]->quantity == 200);  // Order quantity is 200
+    assert(orderbook.order_info(asks.at(Price(101.00))[0]).price == Price(101.00));   // Order price is 101.00
 
     cout << "test_add_order passed!" << endl;
 }
@@ -38,25 +55,25 @@ void test_execute_market_order() {
     Orderbook orderbook(false);
 
     // Add multiple bid orders
-    orderbook.add_order(100, 100.50, BookSide::bid);
-    orderbook.add_order(150, 100.50, BookSide::bid);
+    orderbook.add_order(100, Price(100.50), BookSide::bid);
+    orderbook.add_order(150, Price(100.50), BookSide::bid);
     // Add multiple ask orders (though market sell order works against bids)
-    orderbook.add_order(200, 101.00, BookSide::ask);
-    orderbook.add_order(250, 101.00, BookSide::ask);
+    orderbook.add_order(200, Price(101.00), BookSide::ask);
+    orderbook.add_order(250, Price(101.00), BookSide::ask);
 
     // Execute a market order to sell 200 units (should fill against bids)
-    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::market, 200, Side::sell, 0);
+    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::market, 200, Side::sell);
 
     const auto& bids = orderbook.get_bids();
     // Expect 200 units filled at 100.50 price
     assert(units_transacted == 200);
-    assert(total_value == 100.50 * 200);
+    assert(total_value == Notional(100.50 * 200));
 
     // After filling, the bid orders at 100.50 should be reduced:
     // Initially, there were two orders: one with 100 and one with 150 (total 250).
     // Filling 200 units should remove the first 100 completely and reduce the second from 150 to 50.
-    assert(bids.at(100.50).size() == 1);
-    assert(bids.at(100.50)[0]->quantity == 50);
+    assert(bids.at(Price(100.50)).size() == 1);
+    assert(bids.at(Price(100.50))[0]->quantity == 50);
 
     cout << "test_execute_market_order passed!" << endl;
 }
@@ -66,23 +83,23 @@ void test_execute_limit_order() {
     Orderbook orderbook(false);
 
     // Add multiple bid and ask orders
-    orderbook.add_order(100, 100.50, BookSide::bid);
-    orderbook.add_order(150, 100.50, BookSide::bid);
-    orderbook.add_order(200, 101.00, BookSide::ask);
-    orderbook.add_order(250, 101.00, BookSide::ask);
+    orderbook.add_order(100, Price(100.50), BookSide::bid);
+    orderbook.add_order(150, Price(100.50), BookSide::bid);
+    orderbook.add_order(200, Price(101.00), BookSide::ask);
+    orderbook.add_order(250, Price(101.00), BookSide::ask);
 
     // Execute a limit order to buy 300 units at 101.00
-    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::limit, 300, Side::buy, 101.00);
+    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::limit, 300, Side::buy, Price(101.00));
 
     const auto& asks = orderbook.get_asks();
     // Expect 300 units filled at 101.00 price level
     assert(units_transacted == 300);
-    assert(total_value == 101.00 * 300);
+    assert(total_value == Notional(101.00 * 300));
 
     // Initially there were two ask orders at 101.00 (200 and 250 = 450).
     // Filling 300 should remove the 200-unit order entirely and reduce the 250-unit order to 150.
-    assert(asks.at(101.00).size() == 1);
-    assert(asks.at(101.00)[0]->quantity == 150);
+    assert(asks.at(Price(101.00)).size() == 1);
+    assert(asks.at(Price(101.00))[0]->quantity == 150);
 
     cout << "test_execute_limit_order passed!" << endl;
 }
@@ -91,14 +108,14 @@ void test_execute_limit_order() {
 void test_best_quote() {
     Orderbook orderbook(false);
 
-    orderbook.add_order(100, 100.50, BookSide::bid);
-    orderbook.add_order(200, 101.00, BookSide::ask);
+    orderbook.add_order(100, Price(100.50), BookSide::bid);
+    orderbook.add_order(200, Price(101.00), BookSide::ask);
 
-    double best_bid = orderbook.best_quote(BookSide::bid);
-    double best_ask = orderbook.best_quote(BookSide::ask);
+    Price best_bid = orderbook.best_quote(BookSide::bid);
+    Price best_ask = orderbook.best_quote(BookSide::ask);
 
-    assert(best_bid == 100.50);
-    assert(best_ask == 101.00);
+    assert(best_bid == Price(100.50));
+    assert(best_ask == Price(101.00));
 
     cout << "test_best_quote passed!" << endl;
 }
@@ -108,22 +125,22 @@ void test_small_market_order_best_ask() {
     Orderbook orderbook(false);
 
     // Add three ask orders at different prices
-    orderbook.add_order(1000, 101.00, BookSide::ask); // Best ask
-    orderbook.add_order(1500, 102.00, BookSide::ask);
-    orderbook.add_order(2000, 103.00, BookSide::ask);
+    orderbook.add_order(1000, Price(101.00), BookSide::ask); // Best ask
+    orderbook.add_order(1500, Price(102.00), BookSide::ask);
+    orderbook.add_order(2000, Price(103.00), BookSide::ask);
 
     // Execute a market order to buy 100 units (should fill at best ask: 101.00)
-    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::market, 100, Side::buy, 0);
+    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::market, 100, Side::buy);
 
     const auto& asks = orderbook.get_asks();
     assert(units_transacted == 100);
-    assert(total_value == 101.00 * 100);
+    assert(total_value == Notional(101.00 * 100));
 
     // The best ask at 101.00 should be reduced from 1000 to 900
-    assert(asks.at(101.00)[0]->quantity == 900);
+    assert(asks.at(Price(101.00))[0]->quantity == 900);
     // The orders at higher price levels should remain unchanged.
-    assert(asks.at(102.00)[0]->quantity == 1500);
-    assert(asks.at(103.00)[0]->quantity == 2000);
+    assert(asks.at(Price(102.00))[0]->quantity == 1500);
+    assert(asks.at(Price(103.00))[0]->quantity == 2000);
 
     cout << "test_small_market_order_best_ask passed!" << endl;
 }
@@ -132,15 +149,15 @@ void test_modify_and_delete_order() {
     Orderbook orderbook(false);
 
     // Add an order. We'll capture its ID so we can modify/delete it.
-    orderbook.add_order(100, 100.50, BookSide::bid);
+    orderbook.add_order(100, Price(100.50), BookSide::bid);
 
     // Retrieve the bids map and extract the first (and only) order at 100.50
     const auto& bids = orderbook.get_bids();
     assert(!bids.empty());
-    assert(bids.at(100.50).size() == 1);
+    assert(bids.at(Price(100.50)).size() == 1);
 
     // Capture the ID of this order
-    uint64_t orderId = bids.at(100.50)[0]->id;
+    uint64_t orderId = bids.at(Price(100.50))[0]->id;
 
     // ==========================
     // Time the modify_order call
@@ -151,7 +168,7 @@ void test_modify_and_delete_order() {
 
     // Confirm modify worked
     assert(modified && "modify_order should return true for a valid ID");
-    assert(bids.at(100.50)[0]->quantity == 999);
+    assert(bids.at(Price(100.50))[0]->quantity == 999);
 
     // Print how long modify_order took
     cout << "modify_order took: " << (end_modify - start_modify) 
@@ -167,10 +184,9 @@ void test_modify_and_delete_order() {
     // Confirm delete worked
     assert(deleted && "delete_order should return true for a valid ID");
 
-    // Verify that the order is gone
-    if (bids.find(100.50) != bids.end()) {
-        assert(bids.at(100.50).empty());
-    }
+    // Verify that the order is gone and its level was retired
+    assert(!bids.contains(Price(100.50)));
+    assert(bids.empty());
 
     // Print how long delete_order took
     cout << "delete_order took: " << (end_delete - start_delete)
@@ -179,6 +195,1302 @@ void test_modify_and_delete_order() {
     cout << "test_modify_and_delete_order passed!" << endl;
 }
 
+// Prices that differ only by floating point noise must share one level
+void test_tick_normalization() {
+    Orderbook orderbook(false);
+
+    orderbook.add_order(10, Price(100.1), BookSide::bid);
+    orderbook.add_order(20, Price(100.05 + 0.05), BookSide::bid);
+
+    const auto& bids = orderbook.get_bids();
+    assert(bids.size() == 1);
+    assert(bids.at(Price(100.10)).size() == 2);
+    assert(orderbook.order_info(bids.at(Price(100.10))[1]).price ==
+           orderbook.order_info(bids.at(Price(100.10))[0]).price);
+
+    // Off-tick limits round away from the spread, a bid down and an ask up, so none trades through its price
+    orderbook.add_order(30, Price(99.996), BookSide::bid);
+    assert(bids.at(Price(99.99))[0]->quantity == 30);
+    orderbook.add_order(40, Price(100.204), BookSide::ask);
+    assert(orderbook.get_asks().at(Price(100.21))[0]->quantity == 40);
+
+    Orderbook crossing(false);
+    crossing.add_order(10, Price(100.00), BookSide::ask);
+    crossing.add_order(10, Price(99.00), BookSide::bid);
+    assert(crossing.handle_order(OrderType::limit, 10, Side::sell, Price(99.004)).first == 0);
+    assert(crossing.get_asks().at(Price(99.01)).total_quantity == 10);
+    assert(crossing.handle_order(OrderType::limit, 10, Side::buy, Price(99.996)).first == 10);
+    assert(crossing.get_asks().at(Price(100.00)).total_quantity == 10);
+    assert(crossing.handle_order(OrderType::limit, 10, Side::buy, Price(99.996)).first == 0);
+    assert(crossing.get_bids().at(Price(99.99)).total_quantity == 10);
+    assert(crossing.handle_order(OrderType::limit, 10, Side::buy, Price(100.004)).first == 10);
+
+    cout << "test_tick_normalization passed!" << endl;
+}
+
+// Prices and ticks convert both ways exactly on a ladder with an odd tick and reference, sums of many fills keep
+// every unit, notional does not overflow 64 bits and decimals that do not fit land off the ladder
+void test_fixed_point_prices() {
+    assert(Price(100.1).units == 100'100'000 && Price(100.05 + 0.05) == Price(100.1) && Price(-2.5).units == -2'500'000);
+    assert(!Price(NAN).valid() && !Price(1e300).valid() && Price::invalid() < Price(-1e12));
+
+    PriceLadder<BookSide::bid> ladder(LadderConfig{Price(0.05), Price(12.35), 1 << 12});
+    for (size_t tick = 0; tick < (1 << 12); ++tick) {
+        const Price price = ladder.tick_to_price(tick);
+        assert(ladder.price_to_tick(price) == tick && ladder.price_to_tick(Price(price.to_double())) == tick);
+    }
+    assert(ladder.price_to_tick(Price(12.374999)) == 0);
+    assert(ladder.price_to_tick(Price(12.375)) == 1 && ladder.price_to_tick(Price(12.33)) == 0);
+    for (double off_ladder : {12.32, 1e300, static_cast<double>(NAN), -1e18}) {
+        bool threw = false;
+        try { ladder.price_to_tick(Price(off_ladder)); } catch (const std::out_of_range&) { threw = true; }
+        assert(threw);
+    }
+
+    // A thousand fills at 0.1 add up to exactly 100, a double sum would not
+    Orderbook orderbook(false, LadderConfig{Price(0.1), Price{}, 1 << 10});
+    double drifting = 0;
+    for (int i = 0; i < 1000; ++i) {
+        orderbook.add_order(1, Price(0.1), BookSide::ask);
+        drifting += 1 * 0.1;
+    }
+    auto [units, value] = orderbook.handle_order(OrderType::market, 1000, Side::buy);
+    assert(units == 1000 && value == Notional(100.0) && value.average(units) == Price(0.1) && drifting != 100.0);
+
+    // Two billion units at a billion each is past int64 price units, not past 128 bits
+    Notional large;
+    large.add(2'000'000'000, Price(1e9));
+    large.add(2'000'000'000, Price(1e9));
+    assert(large.units == static_cast<__int128>(4'000'000'000) * 1'000'000'000 * price_scale);
+    assert(large.average(4'000'000'000) == Price(1e9));
+
+    cout << "test_fixed_point_prices passed!" << endl;
+}
+
+// Best quote must move to the next occupied level once the touch is emptied
+void test_best_level_tracking() {
+    Orderbook orderbook(false);
+
+    orderbook.add_order(100, Price(101.00), BookSide::ask);
+    orderbook.add_order(100, Price(105.00), BookSide::ask);
+    orderbook.add_order(100, Price(230.00), BookSide::ask);
+    orderbook.add_order(100, Price(99.00), BookSide::bid);
+    orderbook.add_order(100, Price(12.34), BookSide::bid);
+
+    assert(orderbook.best_quote(BookSide::ask) == Price(101.00));
+    assert(orderbook.best_quote(BookSide::bid) == Price(99.00));
+
+    // Sweep two ask levels, the touch skips the gap to 230.00
+    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::market, 200, Side::buy);
+    assert(units_transacted == 200);
+    assert(total_value == Notional(101.00 * 100 + 105.00 * 100));
+    assert(orderbook.best_quote(BookSide::ask) == Price(230.00));
+    assert(orderbook.get_asks().size() == 1);
+
+    orderbook.handle_order(OrderType::market, 100, Side::sell);
+    assert(orderbook.best_quote(BookSide::bid) == Price(12.34));
+
+    // Emptying a side leaves it empty instead of pointing at a stale level
+    orderbook.handle_order(OrderType::market, 1000, Side::sell);
+    assert(orderbook.get_bids().empty());
+    assert(orderbook.best_quote(BookSide::bid) == Price{});
+
+    cout << "test_best_level_tracking passed!" << endl;
+}
+
+// Limit orders outside the ladder are rejected before the book is touched
+void test_price_outside_ladder() {
+    LadderConfig config;
+    config.tick_size = Price(0.5);
+    config.reference_price = Price(50.0);
+    config.num_levels = 200; // covers 50.00 to 149.50
+    Orderbook orderbook(false, config);
+
+    orderbook.add_order(100, Price(60.00), BookSide::ask);
+
+    bool threw = false;
+    try {
+        orderbook.handle_order(OrderType::limit, 50, Side::buy, Price(150.00));
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(orderbook.get_asks().at(Price(60.00))[0]->quantity == 100);
+
+    orderbook.handle_order(OrderType::limit, 50, Side::buy, Price(149.50));
+    assert(orderbook.get_asks().at(Price(60.00))[0]->quantity == 50);
+
+    cout << "test_price_outside_ladder passed!" << endl;
+}
+
+// Unknown ids must not touch the book
+void test_modify_delete_unknown_id() {
+    Orderbook orderbook(false);
+    orderbook.add_order(100, Price(100.50), BookSide::bid);
+
+    assert(!orderbook.modify_order(987654321, 5));
+    assert(!orderbook.delete_order(987654321));
+    assert(orderbook.get_bids().at(Price(100.50))[0]->quantity == 100);
+
+    cout << "test_modify_delete_unknown_id passed!" << endl;
+}
+
+// Cancelling from the middle, head and tail of a queue keeps FIFO order intact
+void test_cancel_preserves_fifo() {
+    Orderbook orderbook(false);
+
+    uint64_t first = orderbook.add_order(10, Price(100.00), BookSide::ask);
+    uint64_t second = orderbook.add_order(20, Price(100.00), BookSide::ask);
+    uint64_t third = orderbook.add_order(30, Price(100.00), BookSide::ask);
+    uint64_t fourth = orderbook.add_order(40, Price(100.00), BookSide::ask);
+
+    const auto& asks = orderbook.get_asks();
+    assert(orderbook.delete_order(second));
+    assert(asks.at(Price(100.00)).size() == 3);
+    assert(asks.at(Price(100.00))[0]->id == first);
+    assert(asks.at(Price(100.00))[1]->id == third);
+
+    assert(orderbook.delete_order(first));
+    assert(orderbook.delete_order(fourth));
+    assert(asks.at(Price(100.00)).size() == 1);
+    assert(asks.at(Price(100.00)).front()->id == third);
+    assert(!orderbook.delete_order(first)); // already gone
+
+    // Quantity reduce keeps the order in place
+    uint64_t fifth = orderbook.add_order(50, Price(100.00), BookSide::ask);
+    assert(orderbook.modify_order(third, 5));
+    auto [units_transacted, total_value] = orderbook.handle_order(OrderType::market, 7, Side::buy);
+    assert(units_transacted == 7);
+    assert(asks.at(Price(100.00)).front()->id == fifth);
+    assert(asks.at(Price(100.00)).front()->quantity == 48);
+
+    // Emptying the level through cancels retires it
+    assert(orderbook.delete_order(fifth));
+    assert(asks.empty());
+    assert(!orderbook.modify_order(fifth, 1));
+
+    cout << "test_cancel_preserves_fifo passed!" << endl;
+}
+
+// Filled and cancelled orders go back to the pool and are reused without growing it
+void test_order_pool_recycles() {
+    Orderbook orderbook(false, LadderConfig{}, 4);
+
+    uint64_t a = orderbook.add_order(10, Price(100.00), BookSide::ask);
+    orderbook.add_order(10, Price(100.00), BookSide::ask);
+    orderbook.add_order(10, Price(101.00), BookSide::ask);
+    assert(orderbook.order_pool_stats().in_use == 3);
+
+    orderbook.delete_order(a);
+    orderbook.handle_order(OrderType::market, 10, Side::buy);
+    assert(orderbook.order_pool_stats().in_use == 1);
+    assert(orderbook.index_pool_stats().in_use == 1);
+
+    for (int i = 0; i < 3; i++) {
+        orderbook.add_order(10, Price(99.00), BookSide::bid);
+    }
+    assert(orderbook.order_pool_stats().high_water_mark == 4);
+    assert(orderbook.order_pool_stats().capacity == 4);
+    assert(orderbook.order_pool_stats().slabs == 1);
+
+    // Past capacity the pool grows by another slab instead of failing
+    orderbook.add_order(10, Price(99.00), BookSide::bid);
+    assert(orderbook.order_pool_stats().slabs == 2);
+    assert(orderbook.get_bids().at(Price(99.00)).size() == 4);
+
+    cout << "test_order_pool_recycles passed!" << endl;
+}
+
+// Each book counts its own ids inside its id space, the index finds them by sequence, recycles emptied pages and
+// keeps an old resting order reachable while new ids run far ahead of it
+void test_order_ids() {
+    Orderbook first(false);
+    Orderbook second(false, LadderConfig{}, 1 << 10, 7);
+    const uint64_t a = first.add_order(10, Price(99.00), BookSide::bid);
+    const uint64_t b = second.add_order(10, Price(99.00), BookSide::bid);
+    assert(a == 1 && OrderIds::space_of(b) == 7 && OrderIds::sequence_of(b) == 1);
+    assert(second.find_order(a) == nullptr && !second.delete_order(a) && first.find_order(b) == nullptr);
+    assert(second.last_order_id() == b && second.id_space() == 7);
+
+    // Ids run several pages past the old order, each page is emptied and handed on to the next
+    for (size_t i = 0; i < 64 * OrderIndex::page_size; ++i) {
+        second.delete_order(second.add_order(10, Price(101.00), BookSide::ask));
+    }
+    assert(second.find_order(b) != nullptr && second.find_order(b)->quantity == 10);
+    assert(second.index_pool_stats().in_use == 1 && second.index_pool_stats().high_water_mark == 2);
+    assert(second.index_pool_stats().slabs == 1);
+    assert(second.modify_order(b, 5) && second.get_bids().at(Price(99.00))[0]->quantity == 5);
+
+    bool threw = false;
+    try { MatchingEngine engine(OrderIds::max_spaces + 1); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+
+    // A restart keeps the space and continues the sequence, a book in another space refuses the snapshot
+    const string path = "test_ids_snapshot.bin";
+    write_snapshot(second, path);
+    SnapshotReader snapshot(path);
+    Orderbook wrong(false);
+    threw = false;
+    try { wrong.load_snapshot(snapshot); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+    Orderbook restored(false, LadderConfig{}, 1 << 10, 7);
+    restored.load_snapshot(snapshot);
+    assert(restored.find_order(b) != nullptr);
+    assert(restored.add_order(10, Price(98.00), BookSide::bid) == second.last_order_id() + 1);
+    std::remove(path.c_str());
+    cout << "test_order_ids passed!" << endl;
+}
+
+// Random churn against a reference map, with keys crowded into long probe runs so erase has to shift entries back
+// across the end of the table, and lookups of unknown ids never adding anything
+void test_flat_id_map() {
+    FlatIdMap<uint64_t> map(8);
+    std::unordered_map<uint64_t, uint64_t> reference;
+    std::mt19937_64 rng(24);
+    for (int i = 0; i < 200000; ++i) {
+        // Multiples of 512 share a home in any table up to 512 slots, the offsets straddle the end of the table
+        const uint64_t key = (1 + rng() % 40) * 512 - 4 + rng() % 8;
+        if (rng() % 3 == 0) {
+            assert(map.erase(key) == (reference.erase(key) == 1));
+        } else {
+            assert(map.insert(key, key * 3 + i) == reference.emplace(key, key * 3 + i).second);
+        }
+        assert(map.size() == reference.size());
+        const uint64_t probe = (1 + rng() % 50) * 512 - 4 + rng() % 8;
+        const uint64_t* found = map.find(probe);
+        auto it = reference.find(probe);
+        assert((found == nullptr) == (it == reference.end()));
+        assert(found == nullptr || *found == it->second);
+    }
+    for (const auto& [key, value] : reference) {
+        assert(map.find(key) != nullptr && *map.find(key) == value);
+    }
+    const size_t capacity = map.capacity();
+    assert(map.find(0) == nullptr && !map.erase(0) && map.capacity() == capacity);
+
+    // The map book no longer creates entries or empty levels for ids it never saw
+    MapOrderbook book(false, 64);
+    const uint64_t id = book.add_order(10, Price(99.00), BookSide::bid);
+    assert(!book.modify_order(id + 100, 5) && !book.delete_order(id + 100));
+    assert(book.order_count() == 1 && book.get_bids().size() == 1 && book.get_asks().empty());
+    assert(book.modify_order(id, 5) && book.get_bids().at(Price(99.00))[0]->quantity == 5);
+    assert(book.delete_order(id) && book.order_count() == 0 && book.get_bids().empty());
+    assert(!book.delete_order(id));
+    cout << "test_flat_id_map passed!" << endl;
+}
+
+// Ring reports full/empty correctly across index wrap-around
+void test_spsc_ring() {
+    SpscRing<int, 4> ring;
+    int value = 0;
+    assert(!ring.try_pop(value));
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 4; i++) {
+            assert(ring.try_push(round * 10 + i));
+        }
+        assert(!ring.try_push(99)); // full
+        assert(ring.size() == 4);
+        for (int i = 0; i < 4; i++) {
+            assert(ring.try_pop(value));
+            assert(value == round * 10 + i);
+        }
+        assert(ring.empty());
+    }
+
+    cout << "test_spsc_ring passed!" << endl;
+}
+
+// Commands sent through the gateway are matched on its thread and answered in order
+void test_order_gateway() {
+    Orderbook orderbook(false);
+    orderbook.add_order(100, Price(101.00), BookSide::ask);
+
+    OrderGateway gateway(orderbook);
+    gateway.start();
+
+    OrderCommand buy;
+    buy.order_type = OrderType::limit;
+    buy.side = Side::buy;
+    buy.quantity = 150;
+    buy.price = Price(101.00);
+    buy.seq = 1;
+    assert(gateway.submit(buy));
+
+    OrderEvent event;
+    while (!gateway.poll(event)) {}
+    assert(event.seq == 1);
+    assert(event.type == EventType::fill);
+    assert(event.units == 100);
+    assert(event.value == Notional(101.00 * 100));
+    uint64_t resting_id = event.order_id;
+    assert(resting_id != 0); // 50 units left resting as a bid
+
+    OrderCommand cancel;
+    cancel.type = CommandType::cancel;
+    cancel.order_id = resting_id;
+    cancel.seq = 2;
+    assert(gateway.submit(cancel));
+    cancel.seq = 3; // second cancel of the same id is rejected
+    assert(gateway.submit(cancel));
+
+    while (!gateway.poll(event)) {}
+    assert(event.seq == 2 && event.type == EventType::ack);
+    while (!gateway.poll(event)) {}
+    assert(event.seq == 3 && event.type == EventType::reject);
+
+    gateway.stop();
+    assert(orderbook.get_bids().empty());
+    assert(orderbook.get_asks().empty());
+
+    cout << "test_order_gateway passed!" << endl;
+}
+
+// Commands reach only the book of their symbol, on the shard that owns it
+void test_matching_engine_routing() {
+    EngineConfig config;
+    config.num_shards = 2;
+    config.ladder.num_levels = 1 << 14;
+    MatchingEngine engine(3, config);
+    assert(engine.shard_of(0) == 0 && engine.shard_of(1) == 1 && engine.shard_of(2) == 0);
+
+    engine.book(2).add_order(100, Price(101.00), BookSide::ask);
+    engine.start();
+
+    OrderCommand buy;
+    buy.order_type = OrderType::market;
+    buy.side = Side::buy;
+    buy.quantity = 40;
+    buy.symbol = 2;
+    assert(engine.submit(buy));
+    buy.symbol = 1; // nothing rests on symbol 1
+    assert(engine.submit(buy));
+    buy.symbol = 3; // unknown symbol never reaches a shard
+    assert(!engine.submit(buy));
+
+    OrderEvent event;
+    while (!engine.poll(0, event)) {}
+    assert(event.symbol == 2 && event.type == EventType::fill && event.units == 40);
+    while (!engine.poll(1, event)) {}
+    assert(event.symbol == 1 && event.type == EventType::ack && event.units == 0);
+
+    engine.stop();
+    assert(engine.book(2).get_asks().at(Price(101.00))[0]->quantity == 60);
+    assert(engine.book(0).get_asks().empty());
+
+    // Symbols can have ladders of their own, and an idle book holds none of its ladder's level pages
+    config.symbol_ladders = {LadderConfig{Price(0.05), Price(50.0), 1 << 10}};
+    config.ladder = LadderConfig{};
+    MatchingEngine wide(2, config);
+    assert(wide.book(0).ladder_config().tick_size == Price(0.05));
+    assert(wide.book(1).ladder_config().num_levels == LadderConfig{}.num_levels);
+    const size_t idle = wide.book(1).memory_bytes();
+    assert(idle < LadderConfig{}.num_levels * sizeof(PriceLevel) / 8);
+    wide.book(1).add_order(10, Price(100.00), BookSide::bid);
+    assert(wide.book(1).memory_bytes() > idle);
+    assert(wide.memory_bytes() == wide.book(0).memory_bytes() + wide.book(1).memory_bytes());
+
+    // A hot symbol's ladder can have its pages backed before the first order, around a price or all of them
+    LadderConfig hot;
+    hot.prefault_levels = 1 << 12;
+    hot.prefault_price = Price(100.0);
+    config.symbol_ladders = {hot};
+    MatchingEngine warm(2, config);
+    const size_t cold = warm.book(1).memory_bytes();
+    const size_t window = 2 * hot.prefault_levels * sizeof(PriceLevel);
+    assert(warm.book(0).memory_bytes() >= cold + window && warm.book(0).memory_bytes() < cold + 2 * window);
+    hot.prefault_price = Price(1e9); // clamped to the top of the ladder
+    const size_t lazy = Orderbook(false, LadderConfig{}).memory_bytes();
+    assert(Orderbook(false, hot).memory_bytes() >= lazy + window);
+    hot.prefault_levels = hot.num_levels;
+    assert(Orderbook(false, hot).memory_bytes() >= lazy + 2 * hot.num_levels * sizeof(PriceLevel));
+
+    cout << "test_matching_engine_routing passed!" << endl;
+}
+
+// A batch gives the same answers as one command at a time, including cancels of orders filled earlier in the batch
+void test_handle_orders_batch() {
+    Orderbook batched(false);
+    Orderbook single(false);
+    uint64_t batched_id = batched.add_order(100, Price(101.00), BookSide::ask);
+    uint64_t single_id = single.add_order(100, Price(101.00), BookSide::ask);
+    batched.add_order(100, Price(102.00), BookSide::ask);
+    single.add_order(100, Price(102.00), BookSide::ask);
+
+    auto make_commands = [](uint64_t resting_id) {
+        vector<OrderCommand> commands(5);
+        commands[0].order_type = OrderType::market; // fills the 101.00 order completely
+        commands[0].quantity = 150;
+        commands[1].type = CommandType::cancel;     // already filled, must be rejected
+        commands[1].order_id = resting_id;
+        commands[2].type = CommandType::modify;     // likewise
+        commands[2].order_id = resting_id;
+        commands[2].quantity = 5;
+        commands[3].order_type = OrderType::limit;  // rests at 100.00
+        commands[3].quantity = 30;
+        commands[3].price = Price(100.00);
+        commands[4].order_type = OrderType::limit;  // off the ladder, rejected
+        commands[4].quantity = 30;
+        commands[4].price = Price(-5.00);
+        for (size_t i = 0; i < commands.size(); i++) commands[i].seq = i;
+        return commands;
+    };
+
+    vector<OrderCommand> batch = make_commands(batched_id);
+    FillSink sink(batch.size());
+    batched.handle_orders(batch, sink);
+
+    vector<OrderCommand> one_by_one = make_commands(single_id);
+    assert(sink.size() == one_by_one.size());
+    for (size_t i = 0; i < one_by_one.size(); i++) {
+        OrderEvent expected = single.handle_command(one_by_one[i]);
+        assert(sink[i].seq == i);
+        assert(sink[i].type == expected.type);
+        assert(sink[i].units == expected.units);
+        assert(sink[i].value == expected.value);
+        assert((sink[i].order_id != 0) == (expected.order_id != 0));
+    }
+    assert(sink[0].type == EventType::fill && sink[0].units == 150);
+    assert(sink[1].type == EventType::reject && sink[2].type == EventType::reject);
+    assert(sink[4].type == EventType::reject);
+
+    // Deferred cleanup ran at the end of the batch
+    assert(batched.order_pool_stats().in_use == 2);
+    assert(batched.get_asks().at(Price(102.00))[0]->quantity == 50);
+    assert(batched.delete_order(sink[3].order_id));
+
+    cout << "test_handle_orders_batch passed!" << endl;
+}
+
+// Replaying a journal rebuilds the same book, even from a file that was never closed cleanly
+void test_journal_replay() {
+    const string path = "test_journal.bin";
+    Orderbook live(false);
+    {
+        JournalConfig config;
+        config.initial_records = 4; // forces the file to grow a few times
+        Journal journal(path, LadderConfig{}, config);
+        live.set_journal(&journal);
+
+        uint64_t bid = live.add_order(50, Price(99.00), BookSide::bid);
+        uint64_t filled = live.add_order(40, Price(101.00), BookSide::ask);
+        live.add_order(60, Price(101.00), BookSide::ask);
+        live.add_order(70, Price(102.00), BookSide::ask);
+        live.handle_order(OrderType::limit, 20, Side::buy, Price(98.50));
+        live.handle_order(OrderType::market, 50, Side::buy);                       // fills `filled`, 10 off the next
+        live.handle_order(OrderType::limit, 120, Side::buy, Price(101.00));               // sweeps 101.00, rests 70
+        uint64_t resting = live.last_resting_id();
+        assert(!live.modify_order(filled, 5));                                    // already filled
+        assert(live.modify_order(resting, 35));
+        assert(live.delete_order(bid));
+        assert(!live.delete_order(bid));
+        try { live.add_order(10, Price(-1.00), BookSide::bid); } catch (const std::out_of_range&) {} // rejected
+        live.set_journal(nullptr);
+        live.add_order(10, Price(97.00), BookSide::bid); // not journaled
+
+        // Read while the journal is still open, as after a crash, the zeroed tail ends it
+        JournalReader crashed(path);
+        assert(crashed.records().size() == journal.size());
+        assert(journal.size() == 12);
+    }
+
+    JournalReader reader(path);
+    assert(reader.records().size() == 12);
+    assert(reader.ladder().tick_size == LadderConfig{}.tick_size);
+
+    Orderbook replayed(false, reader.ladder());
+    assert(replay_journal(reader, replayed) == 12);
+
+    live.delete_order(live.get_bids().at(Price(97.00))[0]->id);
+    assert(replayed.best_quote(BookSide::bid) == live.best_quote(BookSide::bid));
+    assert(replayed.best_quote(BookSide::ask) == live.best_quote(BookSide::ask));
+    assert(replayed.order_pool_stats().in_use == live.order_pool_stats().in_use);
+    assert(replayed.get_bids().size() == 2 && replayed.get_asks().size() == 1);
+    assert(replayed.get_bids().at(Price(101.00))[0]->quantity == 35);
+    assert(replayed.get_bids().at(Price(98.50))[0]->quantity == 20);
+    assert(replayed.get_asks().at(Price(102.00))[0]->quantity == 70);
+
+    std::remove(path.c_str());
+    cout << "test_journal_replay passed!" << endl;
+}
+
+// A snapshot restores levels, FIFO order, ids and timestamps, and a restart replays only the journal after it
+void test_snapshot_restore() {
+    const string journal_path = "test_snapshot_journal.bin";
+    const string snapshot_path = "test_snapshot.bin";
+    Orderbook live(false);
+    uint64_t first_bid, cancelled_later;
+    {
+        Journal journal(journal_path, LadderConfig{});
+        live.set_journal(&journal);
+        first_bid = live.add_order(10, Price(99.00), BookSide::bid);
+        live.add_order(20, Price(99.00), BookSide::bid);
+        live.add_order(30, Price(98.00), BookSide::bid);
+        cancelled_later = live.add_order(40, Price(101.00), BookSide::ask);
+        live.add_order(50, Price(101.00), BookSide::ask);
+
+        pid_t writer = snapshot_in_background(live, snapshot_path);
+        live.add_order(5, Price(97.00), BookSide::bid); // lands after the snapshot's journal position
+        assert(wait_for_snapshot(writer));
+
+        live.delete_order(cancelled_later);
+        live.handle_order(OrderType::market, 15, Side::sell);
+        live.set_journal(nullptr);
+    }
+
+    SnapshotReader snapshot(snapshot_path);
+    assert(snapshot.header().order_count == 5);
+    assert(snapshot.header().level_count == 3);
+    assert(snapshot.header().journal_position == 5);
+
+    Orderbook restored(false, snapshot.ladder());
+    restored.load_snapshot(snapshot);
+    assert(restored.get_bids().at(Price(99.00)).size() == 2);
+    assert(restored.get_bids().at(Price(99.00))[0]->id == first_bid);
+    assert(restored.get_bids().at(Price(99.00))[1]->quantity == 20);
+    assert(restored.get_asks().at(Price(101.00))[0]->id == cancelled_later);
+    assert(restored.order_info(restored.get_bids().at(Price(99.00))[0]).price == Price(99.00));
+    assert(restored.order_info(restored.get_asks().at(Price(101.00))[0]).side == BookSide::ask);
+    assert(restored.add_order(1, Price(90.00), BookSide::bid) > snapshot.header().last_order_id);
+    bool threw = false;
+    try { restored.load_snapshot(snapshot); } catch (const std::logic_error&) { threw = true; }
+    assert(threw);
+
+    // Restart: snapshot plus the three journal records after it ends where the live book did
+    Orderbook restarted(false, snapshot.ladder());
+    restarted.load_snapshot(snapshot);
+    JournalReader journal(journal_path);
+    assert(replay_journal(journal, restarted, snapshot.header().journal_position,
+                          snapshot.header().last_order_id) == 3);
+    assert(restarted.order_pool_stats().in_use == live.order_pool_stats().in_use);
+    assert(restarted.best_quote(BookSide::ask) == Price(101.00));
+    assert(restarted.get_asks().at(Price(101.00)).size() == 1);
+    assert(restarted.get_bids().at(Price(99.00))[0]->quantity == 15);
+    assert(restarted.get_bids().at(Price(97.00))[0]->quantity == 5);
+
+    // Executions after a restore carry on the live book's sequence instead of starting over
+    ExecutionBuffer executions(4);
+    live.handle_order(OrderType::market, 20, Side::sell, Price{}, executions);
+    assert(executions.size() == 2 && executions[1].seq == 4 && live.execution_seq() == 4);
+    write_snapshot(live, snapshot_path);
+    SnapshotReader traded(snapshot_path);
+    assert(traded.header().execution_seq == 4);
+    Orderbook continued(false, traded.ladder());
+    continued.load_snapshot(traded);
+    executions.clear();
+    continued.handle_order(OrderType::market, 1, Side::sell, Price{}, executions);
+    assert(executions.size() == 1 && executions[0].seq == 5);
+
+    std::remove(journal_path.c_str());
+    std::remove(snapshot_path.c_str());
+    cout << "test_snapshot_restore passed!" << endl;
+}
+
+// Each match is reported with maker, taker, price and what is left on both sides, in sequence
+void test_execution_events() {
+    Orderbook orderbook(false);
+    uint64_t maker1 = orderbook.add_order(30, Price(101.00), BookSide::ask);
+    uint64_t maker2 = orderbook.add_order(50, Price(101.00), BookSide::ask);
+    uint64_t maker3 = orderbook.add_order(40, Price(102.00), BookSide::ask);
+
+    ExecutionBuffer executions(16);
+    auto fill = orderbook.handle_order(OrderType::limit, 100, Side::buy, Price(102.00), executions);
+    uint64_t taker = orderbook.last_resting_id();
+    assert(taker == 0); // fully filled, nothing rests
+
+    assert(executions.size() == 3);
+    assert(executions[0].maker_id == maker1 && executions[0].quantity == 30 && executions[0].price == Price(101.00));
+    assert(executions[0].maker_remaining == 0 && executions[0].taker_remaining == 70);
+    assert(executions[1].maker_id == maker2 && executions[1].quantity == 50 && executions[1].taker_remaining == 20);
+    assert(executions[2].maker_id == maker3 && executions[2].quantity == 20 && executions[2].price == Price(102.00));
+    assert(executions[2].maker_remaining == 20 && executions[2].taker_remaining == 0);
+    for (size_t i = 0; i < executions.size(); i++) {
+        assert(executions[i].taker_id == executions[0].taker_id && executions[i].taker_side == Side::buy);
+        assert(executions[i].seq == i + 1);
+    }
+    assert(executions.totals() == fill);
+
+    // A resting remainder keeps the id its executions used
+    executions.clear();
+    orderbook.handle_order(OrderType::limit, 50, Side::buy, Price(102.00), executions);
+    assert(executions.size() == 1 && executions[0].seq == 4);
+    assert(executions[0].taker_id == orderbook.last_resting_id());
+    assert(orderbook.get_bids().at(Price(102.00))[0]->quantity == 30);
+
+    // Batches report through the same buffer
+    executions.clear();
+    vector<OrderCommand> commands(1);
+    commands[0].order_type = OrderType::market;
+    commands[0].side = Side::sell;
+    commands[0].quantity = 10;
+    FillSink sink(1);
+    orderbook.handle_orders(commands, sink, executions);
+    assert(executions.size() == 1 && executions[0].taker_side == Side::sell && executions[0].maker_remaining == 20);
+
+    cout << "test_execution_events passed!" << endl;
+}
+
+// Level totals follow every add, fill, modify and delete, and the publisher sees only the levels that changed
+void test_level_aggregates_and_l2() {
+    Orderbook orderbook(false);
+    L2Publisher l2;
+    orderbook.set_l2_publisher(&l2);
+
+    uint64_t a = orderbook.add_order(30, Price(101.00), BookSide::ask);
+    orderbook.add_order(50, Price(101.00), BookSide::ask);
+    orderbook.add_order(40, Price(102.00), BookSide::ask);
+    uint64_t b = orderbook.add_order(25, Price(99.00), BookSide::bid);
+    assert(l2.size() == 4);
+    assert(l2[1].command == 2 && l2[1].side == BookSide::ask && l2[1].price == Price(101.00));
+    assert(l2[1].quantity == 80 && l2[1].count == 2);
+
+    // A sweep reports each level it traded at, with the same command number
+    l2.clear();
+    orderbook.handle_order(OrderType::market, 90, Side::buy);
+    assert(l2.size() == 2);
+    assert(l2[0].command == 5 && l2[1].command == 5);
+    assert(l2[0].price == Price(101.00) && l2[0].quantity == 0 && l2[0].count == 0);
+    assert(l2[1].price == Price(102.00) && l2[1].quantity == 30 && l2[1].count == 1);
+    assert(orderbook.get_asks().level(orderbook.get_asks().best_tick()).total_quantity == 30);
+
+    // A limit that crosses and rests touches one level on each side
+    l2.clear();
+    orderbook.handle_order(OrderType::limit, 50, Side::buy, Price(102.00));
+    assert(l2.size() == 2);
+    assert(l2[0].side == BookSide::ask && l2[0].quantity == 0);
+    assert(l2[1].side == BookSide::bid && l2[1].price == Price(102.00) && l2[1].quantity == 20);
+
+    l2.clear();
+    assert(orderbook.modify_order(b, 10));
+    assert(!orderbook.modify_order(a, 10)); // filled, no update
+    assert(orderbook.get_bids().at(Price(99.00)).total_quantity == 10);
+    orderbook.add_order(5, Price(99.00), BookSide::bid);
+    assert(orderbook.delete_order(b));
+    assert(l2.size() == 3);
+    assert(l2[0].quantity == 10 && l2[1].quantity == 15 && l2[1].count == 2);
+    assert(l2[2].quantity == 5 && l2[2].count == 1 && l2[2].command == l2[1].command + 1);
+
+    DepthLevel depth[4];
+    assert(orderbook.top_levels(BookSide::bid, depth) == 2);
+    assert(depth[0].price == Price(102.00) && depth[0].quantity == 20 && depth[0].count == 1);
+    assert(depth[1].price == Price(99.00) && depth[1].quantity == 5);
+    assert(orderbook.top_levels(BookSide::ask, depth) == 0);
+    assert(orderbook.top_levels(BookSide::bid, std::span<DepthLevel>(depth, 1)) == 1);
+
+    // A level changed several times by one command is published once, with its final state
+    auto updates_at = [&](BookSide side, Price price) {
+        int found = 0;
+        for (size_t i = 0; i < l2.size(); ++i) {
+            found += l2[i].side == side && l2[i].price == price;
+        }
+        return found;
+    };
+    Orderbook stp(false);
+    stp.set_l2_publisher(&l2);
+    stp.set_self_trade_prevention(StpMode::cancel_oldest);
+    stp.add_order(10, Price(101.00), BookSide::ask, 7);
+    stp.add_order(10, Price(101.00), BookSide::ask, 8);
+    l2.clear();
+    // Cancels owner 7's ask, then trades with owner 8's at the same level
+    assert(stp.handle_order(OrderType::limit, 15, Side::buy, Price(101.00), TimeInForce::gtc, 7).first == 10);
+    assert(l2.size() == 2 && updates_at(BookSide::ask, Price(101.00)) == 1);
+    assert(updates_at(BookSide::bid, Price(101.00)) == 1);
+    assert(l2[0].quantity == 0 && l2[0].count == 0);
+
+    Orderbook pegged(false);
+    pegged.set_l2_publisher(&l2);
+    pegged.add_order(10, Price(99.00), BookSide::bid);
+    pegged.add_order(10, Price(101.00), BookSide::ask);
+    pegged.add_peg(PegType::primary, 5, BookSide::bid);
+    l2.clear();
+    // The new bid and the pegs moving up behind it change 99.50 twice in one command
+    pegged.add_order(10, Price(99.50), BookSide::bid);
+    assert(l2.size() == 2 && updates_at(BookSide::bid, Price(99.50)) == 1);
+    assert(updates_at(BookSide::bid, Price(99.00)) == 1);
+    assert(l2[0].price == Price(99.50) && l2[0].quantity == 15 && l2[0].count == 2);
+    assert(l2[1].quantity == 10 && l2[1].command == l2[0].command);
+
+    cout << "test_level_aggregates_and_l2 passed!" << endl;
+}
+
+// Buckets are exact for small values and within ~3% above, threads record independently, intervals subtract
+void test_latency_histogram() {
+    for (uint64_t v : {0ull, 1ull, 63ull, 64ull, 65ull, 100ull, 1000ull, 123456ull, 1ull << 40, ~0ull}) {
+        size_t bucket = LatencyHistogram::bucket_of(v);
+        assert(bucket < LatencyHistogram::bucket_count);
+        assert(LatencyHistogram::bucket_limit(bucket) >= v);
+        assert(LatencyHistogram::bucket_limit(bucket) - v <= v / 32);
+        if (bucket > 0) assert(LatencyHistogram::bucket_limit(bucket - 1) < v);
+    }
+
+    LatencySnapshot before = LatencyRecorder::snapshot();
+    for (uint64_t ticks = 1; ticks <= 1000; ticks++) {
+        LatencyRecorder::record(LatencyOp::modify, ticks);
+    }
+    std::thread other([] { LatencyRecorder::record(LatencyOp::modify, 1u << 20); });
+    other.join();
+    LatencySnapshot interval = LatencyRecorder::snapshot().since(before);
+    assert(interval.count(LatencyOp::modify) == 1001);
+    assert(interval.count(LatencyOp::add) == 0 && interval.percentile(LatencyOp::add, 0.5) == 0);
+    const double ns = tsc_ns_per_tick();
+    assert(std::abs(interval.percentile(LatencyOp::modify, 0.5) - 500 * ns) <= 16 * ns);
+    assert(interval.percentile(LatencyOp::modify, 0.99) <= interval.percentile(LatencyOp::modify, 0.999));
+    assert(interval.max(LatencyOp::modify) >= (1u << 20) * ns);
+
+    // A book with tracking on times each operation, sampled books only every n-th
+    Orderbook orderbook(false);
+    orderbook.set_latency_tracking(true);
+    before = LatencyRecorder::snapshot();
+    uint64_t id = orderbook.add_order(10, Price(100.00), BookSide::bid);
+    orderbook.handle_order(OrderType::limit, 5, Side::sell, Price(100.00));
+    orderbook.handle_order(OrderType::market, 1, Side::sell);
+    orderbook.modify_order(id, 3);
+    orderbook.delete_order(id);
+    orderbook.set_latency_tracking(true, 4);
+    for (int i = 0; i < 8; i++) orderbook.add_order(1, Price(90.00), BookSide::bid);
+    orderbook.set_latency_tracking(false);
+    orderbook.add_order(1, Price(90.00), BookSide::bid);
+    interval = LatencyRecorder::snapshot().since(before);
+    assert(interval.count(LatencyOp::add) == 3);
+    assert(interval.count(LatencyOp::limit) == 1 && interval.count(LatencyOp::market) == 1);
+    assert(interval.count(LatencyOp::modify) == 1 && interval.count(LatencyOp::cancel) == 1);
+
+    cout << "test_latency_histogram passed!" << endl;
+}
+
+// IOC drops its remainder, FOK trades all or nothing and a killed FOK leaves the book as it was
+void test_time_in_force() {
+    Orderbook orderbook(false);
+    orderbook.add_order(30, Price(101.00), BookSide::ask);
+    orderbook.add_order(20, Price(101.00), BookSide::ask);
+    orderbook.add_order(40, Price(102.00), BookSide::ask);
+    orderbook.add_order(25, Price(99.00), BookSide::bid);
+
+    // IOC: takes 101.00 and stops at its limit, nothing rests
+    auto fill = orderbook.handle_order(OrderType::limit, 60, Side::buy, Price(101.00), TimeInForce::ioc);
+    assert(fill.first == 50 && orderbook.last_resting_id() == 0);
+    assert(orderbook.best_quote(BookSide::bid) == Price(99.00) && orderbook.best_quote(BookSide::ask) == Price(102.00));
+    assert(orderbook.handle_order(OrderType::limit, 10, Side::sell, Price(100.00), TimeInForce::ioc).first == 0);
+    assert(orderbook.best_quote(BookSide::ask) == Price(102.00));
+
+    // FOK limit: 40 reachable at 102.00, so 41 is killed without a single fill and 40 goes through
+    uint64_t far = orderbook.add_order(15, Price(103.00), BookSide::ask);
+    ExecutionBuffer executions;
+    fill = orderbook.handle_order(OrderType::limit, 41, Side::buy, Price(102.00), executions, TimeInForce::fok);
+    assert(fill.first == 0 && executions.size() == 0 && orderbook.last_resting_id() == 0);
+    assert(orderbook.get_asks().at(Price(102.00)).total_quantity == 40 && orderbook.get_asks().size() == 2);
+
+    // FOK market: the whole side counts, 55 is there
+    assert(orderbook.handle_order(OrderType::market, 56, Side::buy, Price{}, TimeInForce::fok).first == 0);
+    fill = orderbook.handle_order(OrderType::market, 50, Side::buy, Price{}, executions, TimeInForce::fok);
+    assert(fill.first == 50 && executions.size() == 2 && executions[1].maker_id == far);
+    assert(orderbook.get_asks().at(Price(103.00))[0]->quantity == 5);
+
+    // Commands: a killed FOK is a reject, IOC/FOK never leave an id behind
+    OrderCommand cmd;
+    cmd.side = Side::sell;
+    cmd.price = Price(99.00);
+    cmd.quantity = 30;
+    cmd.tif = TimeInForce::fok;
+    assert(orderbook.handle_command(cmd).type == EventType::reject);
+    cmd.quantity = 25;
+    OrderEvent event = orderbook.handle_command(cmd);
+    assert(event.type == EventType::fill && event.units == 25 && event.order_id == 0);
+    assert(orderbook.get_bids().empty());
+
+    cout << "test_time_in_force passed!" << endl;
+}
+
+// Icebergs show one peak at a time, refill at the back of their level and survive journal replay and snapshots
+void test_iceberg_orders() {
+    const string journal_path = "test_iceberg_journal.bin";
+    const string snapshot_path = "test_iceberg_snapshot.bin";
+    Orderbook orderbook(false);
+    Journal journal(journal_path, LadderConfig{});
+    orderbook.set_journal(&journal);
+
+    uint64_t first = orderbook.add_order(10, Price(101.00), BookSide::ask);
+    uint64_t iceberg = orderbook.add_iceberg(100, 30, Price(101.00), BookSide::ask);
+    uint64_t last = orderbook.add_order(20, Price(101.00), BookSide::ask);
+    const PriceLevel& level = orderbook.get_asks().at(Price(101.00));
+    assert(level.total_quantity == 60 && level.hidden_quantity == 70);
+    DepthLevel depth[1];
+    orderbook.top_levels(BookSide::ask, depth);
+    assert(depth[0].quantity == 60 && depth[0].count == 3);
+
+    // The displayed 30 fills, the next 30 goes behind `last`
+    ExecutionBuffer executions;
+    orderbook.handle_order(OrderType::market, 45, Side::buy, Price{}, executions);
+    assert(executions.size() == 3 && executions[0].maker_id == first);
+    assert(executions[1].maker_id == iceberg && executions[1].maker_remaining == 30);
+    assert(level[0]->id == last && level[0]->quantity == 15);
+    assert(level[1]->id == iceberg && level[1]->quantity == 30);
+    assert(level.total_quantity == 45 && level.hidden_quantity == 40);
+
+    // Snapshot and journal both carry the reserve
+    write_snapshot(orderbook, snapshot_path);
+    SnapshotReader snapshot(snapshot_path);
+    assert(snapshot.header().iceberg_count == 1);
+    Orderbook restored(false);
+    restored.load_snapshot(snapshot);
+    assert(restored.get_asks().at(Price(101.00)).hidden_quantity == 40);
+
+    // A FOK counts the reserve, 85 is exactly what the level holds
+    assert(orderbook.handle_order(OrderType::market, 86, Side::buy, Price{}, TimeInForce::fok).first == 0);
+    assert(orderbook.handle_order(OrderType::market, 85, Side::buy, Price{}, TimeInForce::fok).first == 85);
+    assert(orderbook.get_asks().empty());
+    assert(restored.handle_order(OrderType::market, 85, Side::buy).first == 85 && restored.get_asks().empty());
+
+    // Cancelling drops the reserve with the order
+    uint64_t bid = orderbook.add_iceberg(50, 10, Price(99.00), BookSide::bid);
+    assert(orderbook.get_bids().at(Price(99.00)).total_quantity == 10);
+    assert(orderbook.delete_order(bid) && orderbook.get_bids().empty());
+    orderbook.add_iceberg(25, 10, Price(98.00), BookSide::bid);
+    orderbook.set_journal(nullptr);
+
+    JournalReader reader(journal_path);
+    Orderbook replayed(false, reader.ladder());
+    replay_journal(reader, replayed);
+    assert(replayed.get_asks().empty());
+    assert(replayed.get_bids().at(Price(98.00)).total_quantity == 10);
+    assert(replayed.get_bids().at(Price(98.00)).hidden_quantity == 15);
+    assert(replayed.handle_order(OrderType::market, 25, Side::sell).first == 25);
+
+    try {
+        orderbook.add_iceberg(10, 0, Price(98.00), BookSide::bid);
+        assert(false);
+    } catch (const std::invalid_argument&) {}
+
+    std::remove(journal_path.c_str());
+    std::remove(snapshot_path.c_str());
+    cout << "test_iceberg_orders passed!" << endl;
+}
+
+// Stops wait off the book until a trade reaches their trigger, then cascade in a fixed order
+void test_stop_orders() {
+    const string journal_path = "test_stop_journal.bin";
+    const string snapshot_path = "test_stop_snapshot.bin";
+    Orderbook orderbook(false);
+    Journal journal(journal_path, LadderConfig{});
+    orderbook.set_journal(&journal);
+
+    for (double price : {100.00, 101.00, 102.00, 103.00}) {
+        orderbook.add_order(10, Price(price), BookSide::ask);
+    }
+    orderbook.add_order(10, Price(98.00), BookSide::bid);
+    uint64_t stop = orderbook.add_stop(OrderType::market, 15, Side::buy, Price(101.00));
+    uint64_t stop_limit = orderbook.add_stop(OrderType::limit, 5, Side::buy, Price(102.00), Price(102.00));
+    uint64_t far = orderbook.add_stop(OrderType::market, 5, Side::sell, Price(96.00));
+    assert(orderbook.pending_stops() == 3 && orderbook.get_asks().at(Price(100.00)).total_quantity == 10);
+
+    // Trading at 100 reaches no trigger
+    assert(orderbook.handle_order(OrderType::market, 10, Side::buy).first == 10);
+    assert(orderbook.pending_stops() == 3 && orderbook.last_trade_price() == Price(100.00));
+
+    // 101 fires the stop, whose fill at 102 fires the stop-limit, which rests under its own id
+    ExecutionBuffer executions;
+    assert(orderbook.handle_order(OrderType::market, 5, Side::buy, Price{}, executions).first == 5);
+    assert(executions.size() == 3);
+    assert(executions[1].taker_id == stop && executions[1].price == Price(101.00) && executions[1].quantity == 5);
+    assert(executions[2].taker_id == stop && executions[2].price == Price(102.00) && executions[2].quantity == 10);
+    assert(orderbook.last_resting_id() == 0 && orderbook.last_trade_price() == Price(102.00));
+    assert(orderbook.get_bids().at(Price(102.00))[0]->id == stop_limit);
+    assert(orderbook.pending_stops() == 1);
+
+    // Cancels reach pending stops, and a stop the last trade already reached fires on arrival
+    assert(orderbook.delete_order(far) && !orderbook.delete_order(far) && orderbook.pending_stops() == 0);
+    orderbook.add_stop(OrderType::market, 5, Side::sell, Price(103.00));
+    assert(orderbook.pending_stops() == 0 && orderbook.best_quote(BookSide::bid) == Price(98.00));
+    try {
+        orderbook.add_stop(OrderType::market, 5, Side::sell, Price(1e9));
+        assert(false);
+    } catch (const std::out_of_range&) {}
+
+    // Snapshot and journal both carry the pending stops and the last trade
+    orderbook.add_stop(OrderType::market, 4, Side::sell, Price(98.00));
+    write_snapshot(orderbook, snapshot_path);
+    SnapshotReader snapshot(snapshot_path);
+    assert(snapshot.header().stop_count == 1);
+    Orderbook restored(false);
+    restored.load_snapshot(snapshot);
+    assert(restored.pending_stops() == 1 && restored.last_trade_price() == Price(102.00));
+    orderbook.set_journal(nullptr);
+
+    JournalReader reader(journal_path);
+    Orderbook replayed(false, reader.ladder());
+    replay_journal(reader, replayed);
+    assert(replayed.pending_stops() == 1 && replayed.get_bids().at(Price(98.00)).total_quantity == 10);
+
+    // Selling into 98 fires it everywhere alike
+    for (Orderbook* book : {&orderbook, &restored, &replayed}) {
+        assert(book->handle_order(OrderType::market, 1, Side::sell).first == 1);
+        assert(book->pending_stops() == 0 && book->get_bids().at(Price(98.00)).total_quantity == 5);
+    }
+
+    std::remove(journal_path.c_str());
+    std::remove(snapshot_path.c_str());
+    cout << "test_stop_orders passed!" << endl;
+}
+
+// Pegged orders follow the unpegged touch as a group, keeping their ids, and never cross each other
+void test_pegged_orders() {
+    const string journal_path = "test_peg_journal.bin";
+    const string snapshot_path = "test_peg_snapshot.bin";
+    Orderbook orderbook(false);
+    Journal journal(journal_path, LadderConfig{});
+    orderbook.set_journal(&journal);
+
+    uint64_t bid = orderbook.add_order(10, Price(99.00), BookSide::bid);
+    orderbook.add_order(10, Price(101.00), BookSide::ask);
+    uint64_t primary = orderbook.add_peg(PegType::primary, 5, BookSide::bid);
+    uint64_t mid = orderbook.add_peg(PegType::mid, 5, BookSide::bid);
+    uint64_t market = orderbook.add_peg(PegType::market, 5, BookSide::ask, 2);
+    uint64_t second = orderbook.add_peg(PegType::primary, 5, BookSide::bid);
+    assert(orderbook.pegged_orders() == 4);
+    assert(orderbook.get_bids().at(Price(99.00))[1]->id == primary);
+    assert(orderbook.get_bids().at(Price(99.00))[2]->id == second);
+    // The mid is 100.00, a tick is left to neither side
+    assert(orderbook.get_bids().at(Price(99.99))[0]->id == mid);
+    assert(orderbook.get_asks().at(Price(100.01))[0]->id == market);
+
+    // A better plain bid moves the whole primary group behind it, the mid pegs follow the new midpoint
+    uint64_t better = orderbook.add_order(10, Price(99.50), BookSide::bid);
+    const PriceLevel& touch = orderbook.get_bids().at(Price(99.50));
+    assert(touch.size() == 3 && touch[0]->id == better && touch[1]->id == primary && touch[2]->id == second);
+    assert(orderbook.get_bids().at(Price(99.00)).size() == 1 && orderbook.get_bids().at(Price(99.00))[0]->id == bid);
+    assert(orderbook.best_quote(BookSide::bid) == Price(100.24));
+    assert(orderbook.best_quote(BookSide::ask) == Price(100.26));
+    assert(orderbook.order_info(touch[1]).price == Price(99.50));
+
+    // Pegs fill and cancel like any order, and fall back when the touch does
+    assert(orderbook.handle_order(OrderType::market, 5, Side::sell).first == 5);
+    assert(orderbook.delete_order(second) && !orderbook.delete_order(mid));
+    assert(orderbook.delete_order(better) && orderbook.pegged_orders() == 2);
+    assert(orderbook.get_bids().at(Price(99.00)).size() == 2);
+    assert(orderbook.get_bids().at(Price(99.00))[1]->id == primary);
+    assert(orderbook.get_asks().at(Price(100.01))[0]->id == market);
+
+    write_snapshot(orderbook, snapshot_path);
+    SnapshotReader snapshot(snapshot_path);
+    assert(snapshot.header().peg_count == 2);
+    Orderbook restored(false);
+    restored.load_snapshot(snapshot);
+    orderbook.set_journal(nullptr);
+    JournalReader reader(journal_path);
+    Orderbook replayed(false, reader.ladder());
+    replay_journal(reader, replayed);
+
+    // Restored and replayed pegs keep following
+    for (Orderbook* book : {&orderbook, &restored, &replayed}) {
+        assert(book->pegged_orders() == 2);
+        book->add_order(10, Price(100.60), BookSide::ask);
+        assert(book->get_bids().at(Price(99.00)).size() == 2 && book->best_quote(BookSide::ask) == Price(99.81));
+    }
+
+    // On a one-sided book a market peg stays a tick behind the opposite touch, through repricing too, and a peg
+    // with no tick left there is rejected
+    Orderbook one_sided(false);
+    uint64_t offer = one_sided.add_order(10, Price(101.00), BookSide::ask);
+    uint64_t follower = one_sided.add_peg(PegType::market, 5, BookSide::bid);
+    assert(one_sided.get_bids().at(Price(100.99))[0]->id == follower);
+    assert(one_sided.best_quote(BookSide::ask) == Price(101.00));
+    assert(one_sided.handle_order(OrderType::limit, 5, Side::sell, Price(101.00)).first == 0);
+    assert(one_sided.get_asks().at(Price(101.00)).size() == 2);
+    assert(one_sided.delete_order(offer));
+    assert(one_sided.handle_order(OrderType::limit, 5, Side::buy, Price(101.00)).first == 5);
+    one_sided.add_order(10, Price(102.00), BookSide::ask);
+    assert(one_sided.get_bids().at(Price(101.99))[0]->id == follower);
+    Orderbook floor(false);
+    floor.add_order(10, Price(0.00), BookSide::ask);
+    try {
+        floor.add_peg(PegType::market, 5, BookSide::bid);
+        assert(false);
+    } catch (const std::invalid_argument&) {}
+    assert(floor.peg_group_count() == 0);
+
+    // A peg with nothing to peg to is rejected without leaving a group behind
+    Orderbook empty(false);
+    try {
+        empty.add_peg(PegType::primary, 5, BookSide::bid);
+        assert(false);
+    } catch (const std::invalid_argument&) {}
+    assert(empty.peg_group_count() == 0);
+    empty.add_order(10, Price(99.00), BookSide::bid);
+    empty.add_peg(PegType::primary, 5, BookSide::bid);
+    assert(empty.peg_group_count() == 1 && empty.get_bids().at(Price(99.00)).size() == 2);
+
+    std::remove(journal_path.c_str());
+    std::remove(snapshot_path.c_str());
+    cout << "test_pegged_orders passed!" << endl;
+}
+
+// A taker never trades with a resting order of its own owner, each mode settling the conflict its own way
+void test_self_trade_prevention() {
+    struct Case {
+        StpMode mode;
+        int units;     // the buyer's fill
+        int own_left;  // owner 7's ask afterwards, 0 once gone
+        int rested;    // the buyer's remainder on the bid
+    };
+    const Case cases[] = {
+        {StpMode::none, 15, 0, 0},
+        {StpMode::cancel_newest, 0, 10, 0},
+        {StpMode::cancel_oldest, 10, 0, 5},
+        {StpMode::cancel_both, 0, 0, 0},
+        {StpMode::decrement, 5, 0, 0},
+    };
+    for (const Case& c : cases) {
+        Orderbook orderbook(false);
+        orderbook.set_self_trade_prevention(c.mode);
+        uint64_t own = orderbook.add_order(10, Price(101.00), BookSide::ask, 7);
+        orderbook.add_order(10, Price(101.00), BookSide::ask, 8);
+        assert(orderbook.handle_order(OrderType::limit, 15, Side::buy, Price(101.00), TimeInForce::gtc, 7).first ==
+               c.units);
+        assert(orderbook.modify_order(own, 10) == (c.own_left != 0));
+        assert(orderbook.get_bids().empty() == (c.rested == 0));
+        if (c.rested != 0) {
+            assert(orderbook.get_bids().at(Price(101.00)).total_quantity == c.rested);
+        }
+        assert(orderbook.self_trades_prevented() == (c.mode == StpMode::none ? 0u : 1u));
+    }
+
+    Orderbook orderbook(false);
+    orderbook.set_self_trade_prevention(StpMode::cancel_newest);
+    orderbook.add_order(10, Price(101.00), BookSide::ask, 7);
+    orderbook.add_order(10, Price(101.00), BookSide::ask, 8);
+    // Takers without an owner trade with anyone, a FOK that would meet its own order is killed untouched
+    assert(orderbook.handle_order(OrderType::market, 5, Side::buy, Price{}, TimeInForce::fok, 7).first == 0);
+    assert(orderbook.get_asks().at(Price(101.00)).total_quantity == 20);
+    assert(orderbook.handle_order(OrderType::market, 5, Side::buy).first == 5);
+    orderbook.set_self_trade_prevention(StpMode::cancel_oldest);
+    assert(orderbook.handle_order(OrderType::market, 11, Side::buy, Price{}, TimeInForce::fok, 7).first == 0);
+    assert(orderbook.handle_order(OrderType::market, 10, Side::buy, Price{}, TimeInForce::fok, 7).first == 10);
+    assert(orderbook.get_asks().empty());
+
+    // Owners and the mode survive snapshots and journal replay. The journal is attached under cancel_oldest and
+    // switches to cancel_newest, which keeps owner 7's ask when owner 7 buys into it.
+    const string snapshot_path = "test_stp_snapshot.bin";
+    const string journal_path = "test_stp_journal.bin";
+    {
+        Journal journal(journal_path, LadderConfig{});
+        orderbook.set_journal(&journal);
+        orderbook.add_order(10, Price(99.00), BookSide::bid, 7);
+        orderbook.set_self_trade_prevention(StpMode::cancel_newest);
+        orderbook.add_order(10, Price(101.00), BookSide::ask, 7);
+        assert(orderbook.handle_order(OrderType::limit, 10, Side::buy, Price(101.00), TimeInForce::gtc, 7).first == 0);
+        orderbook.set_journal(nullptr);
+    }
+    write_snapshot(orderbook, snapshot_path);
+    SnapshotReader snapshot(snapshot_path);
+    Orderbook restored(false);
+    restored.load_snapshot(snapshot);
+    JournalReader reader(journal_path);
+    Orderbook replayed(false, reader.ladder());
+    replay_journal(reader, replayed);
+    for (Orderbook* book : {&orderbook, &restored, &replayed}) {
+        assert(book->self_trade_prevention() == StpMode::cancel_newest);
+        assert(book->get_asks().at(Price(101.00)).total_quantity == 10);
+    }
+    for (Orderbook* book : {&restored, &replayed}) {
+        assert(book->handle_order(OrderType::market, 10, Side::sell, Price{}, TimeInForce::gtc, 7).first == 0);
+        assert(book->handle_order(OrderType::market, 10, Side::sell, Price{}, TimeInForce::gtc, 9).first == 10);
+    }
+
+    try {
+        orderbook.add_order(10, Price(99.00), BookSide::bid, Order::no_owner);
+        assert(false);
+    } catch (const std::invalid_argument&) {}
+
+    std::remove(snapshot_path.c_str());
+    std::remove(journal_path.c_str());
+    cout << "test_self_trade_prevention passed!" << endl;
+}
+
+// The gate rejects with a reason instead of throwing and keeps per-account exposure in step with fills
+void test_risk_gate() {
+    Orderbook orderbook(false);
+    RiskConfig config;
+    config.max_order_quantity = 1000;
+    config.collar = 0.05;
+    config.max_accounts = 16;
+    config.default_limits = AccountLimits{500, 800};
+    RiskGate gate(orderbook, config);
+
+    assert(gate.submit(OrderType::limit, 0, Side::buy, Price(100.00), 1).reject == RiskReject::bad_quantity);
+    assert(gate.submit(OrderType::limit, 2000, Side::buy, Price(100.00), 1).reject == RiskReject::too_large);
+    assert(gate.submit(OrderType::limit, 10, Side::buy, Price(100.00), 0).reject == RiskReject::unknown_account);
+    assert(gate.submit(OrderType::limit, 10, Side::buy, Price(100.00), 16).reject == RiskReject::unknown_account);
+    assert(gate.submit(OrderType::limit, 10, Side::buy, Price(-1.0), 1).reject == RiskReject::bad_price);
+    assert(gate.submit(OrderType::limit, 10, Side::buy, Price(NAN), 1).reject == RiskReject::bad_price);
+    // Nothing to collar against yet, the ladder still bounds the price
+    assert(gate.submit(OrderType::limit, 10, Side::buy, Price(1e9), 1).reject == RiskReject::bad_price);
+
+    GateResult bid = gate.submit(OrderType::limit, 100, Side::buy, Price(100.00), 1);
+    assert(bid.accepted() && bid.order_id != 0 && gate.account(1).open_buy == 100);
+    assert(gate.submit(OrderType::limit, 50, Side::sell, Price(120.00), 2).reject == RiskReject::outside_collar);
+    GateResult sell = gate.submit(OrderType::limit, 50, Side::sell, Price(100.00), 2);
+    assert(sell.accepted() && sell.units == 50 && sell.order_id == 0 && gate.executions().size() == 1);
+    assert(gate.account(1).position == 50 && gate.account(1).open_buy == 50);
+    assert(gate.account(2).position == -50 && gate.account(2).open_sell == 0);
+
+    // Open exposure counts what already rests
+    assert(gate.submit(OrderType::limit, 460, Side::buy, Price(99.00), 1).reject == RiskReject::open_limit);
+    uint64_t second = gate.submit(OrderType::limit, 450, Side::buy, Price(99.00), 1).order_id;
+    assert(second != 0 && gate.account(1).open_buy == 500);
+
+    // Position counts the side's resting orders as filled
+    gate.set_limits(3, AccountLimits{1000, 100});
+    assert(gate.submit(OrderType::market, 150, Side::sell, Price{}, 3).reject == RiskReject::position_limit);
+    assert(gate.submit(OrderType::market, 60, Side::sell, Price{}, 3).units == 60);
+    assert(gate.account(3).position == -60);
+    assert(gate.account(1).position == 110 && gate.account(1).open_buy == 440);
+
+    assert(gate.cancel(2, second) == RiskReject::unknown_order);
+    assert(gate.modify(1, second, 500) == RiskReject::none && gate.account(1).open_buy == 500);
+    assert(gate.modify(1, second, 501) == RiskReject::open_limit);
+    assert(gate.cancel(1, second) == RiskReject::none && gate.account(1).open_buy == 0);
+    assert(orderbook.get_bids().empty());
+
+    // Makers self-trade prevention removes leave open exposure too. Account 4 is only at its open limit if the
+    // bid its own sell cancelled still counted.
+    orderbook.set_self_trade_prevention(StpMode::cancel_oldest);
+    gate.set_limits(4, AccountLimits{100, 1000});
+    assert(gate.submit(OrderType::limit, 100, Side::sell, Price(101.00), 4).accepted());
+    assert(gate.submit(OrderType::limit, 40, Side::buy, Price(101.00), 4).units == 0);
+    assert(gate.account(4).open_sell == 0 && gate.account(4).open_buy == 40);
+    GateResult own = gate.submit(OrderType::limit, 100, Side::sell, Price(101.00), 4);
+    assert(own.accepted() && own.order_id != 0 && own.units == 0);
+    assert(gate.account(4).open_buy == 0 && gate.account(4).open_sell == 100 && gate.account(4).position == 0);
+    orderbook.set_self_trade_prevention(StpMode::decrement);
+    assert(gate.submit(OrderType::limit, 30, Side::buy, Price(101.00), 4).order_id == 0);
+    assert(gate.self_trade_cancels().size() == 1);
+    const SelfTradeCancel& cut = gate.self_trade_cancels()[0];
+    assert(cut.maker_id == own.order_id && cut.quantity == 30 && cut.maker_remaining == 70 && cut.maker_owner == 4);
+    assert(gate.account(4).open_sell == 70 && gate.account(4).open_buy == 0);
+    cout << "test_risk_gate passed!" << endl;
+}
+
+// The view follows the best levels, skips commands behind them, and readers on other threads never see a
+// half-published book: every order is 10 lots, so a level whose quantity is not 10 per order was torn.
+void test_book_view() {
+    Orderbook orderbook(false);
+    orderbook.add_order(10, Price(99.00), BookSide::bid);
+    orderbook.add_order(10, Price(101.00), BookSide::ask);
+    BookView view;
+    orderbook.set_book_view(&view);
+    assert(view.publishes() == 1);
+    TopOfBook top = view.top();
+    assert(top.bid.price == Price(99.00) && top.bid.quantity == 10);
+    assert(top.ask.price == Price(101.00) && top.ask.count == 1);
+
+    for (int i = 1; i < static_cast<int>(BookView::depth); ++i) {
+        orderbook.add_order(10, Price(99.00 - i * 0.01), BookSide::bid);
+    }
+    const uint64_t full = view.publishes();
+    orderbook.add_order(10, Price(98.50), BookSide::bid); // behind the tenth level
+    assert(view.publishes() == full);
+    orderbook.add_order(20, Price(99.00), BookSide::bid);
+    assert(view.publishes() == full + 1);
+    BookSnapshot snapshot = view.read();
+    assert(snapshot.bid_count == BookView::depth && snapshot.ask_count == 1);
+    assert(snapshot.bids[0].quantity == 30 && snapshot.bids[0].count == 2);
+    assert(snapshot.bids[BookView::depth - 1].price == Price(98.91));
+    orderbook.handle_order(OrderType::market, 10, Side::sell);
+    orderbook.handle_order(OrderType::market, 10, Side::buy);
+    top = view.top();
+    assert(top.bid.quantity == 20 && top.ask.count == 0 && top.command == view.read().command);
+
+    Orderbook book(false);
+    BookView shared;
+    book.set_book_view(&shared);
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> reads{0};
+    auto reader = [&] {
+        uint64_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            BookSnapshot s = shared.read();
+            assert(s.command >= last && s.bid_count <= BookView::depth && s.ask_count <= BookView::depth);
+            last = s.command;
+            for (uint32_t i = 0; i < s.bid_count; ++i) {
+                assert(s.bids[i].quantity == 10 * static_cast<int64_t>(s.bids[i].count) && s.bids[i].count > 0);
+                assert(i == 0 || s.bids[i].price < s.bids[i - 1].price);
+            }
+            for (uint32_t i = 0; i < s.ask_count; ++i) {
+                assert(s.asks[i].quantity == 10 * static_cast<int64_t>(s.asks[i].count) && s.asks[i].count > 0);
+                assert(i == 0 || s.asks[i].price > s.asks[i - 1].price);
+            }
+            assert(s.bid_count == 0 || s.ask_count == 0 || s.bids[0].price < s.asks[0].price);
+            TopOfBook t = shared.top();
+            assert(t.command >= last && t.bid.quantity == 10 * static_cast<int64_t>(t.bid.count));
+            reads.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back(reader);
+    }
+    std::mt19937_64 rng(5);
+    std::vector<uint64_t> live;
+    for (int i = 0; i < 200000; ++i) {
+        const uint64_t r = rng() % 10;
+        const bool buy = rng() % 2 == 0;
+        if (r < 3 && !live.empty()) {
+            size_t index = rng() % live.size();
+            book.delete_order(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        } else if (r < 4) {
+            book.handle_order(OrderType::market, 10, buy ? Side::buy : Side::sell);
+        } else {
+            const Price price(buy ? 99.99 - (rng() % 30) * 0.01 : 100.00 + (rng() % 30) * 0.01);
+            live.push_back(book.add_order(10, price, buy ? BookSide::bid : BookSide::ask));
+        }
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& t : readers) {
+        t.join();
+    }
+    assert(reads.load() > 0);
+    BookSnapshot last = shared.read();
+    DepthLevel bids[BookView::depth];
+    assert(book.top_levels(BookSide::bid, bids) == last.bid_count);
+    for (uint32_t i = 0; i < last.bid_count; ++i) {
+        assert(bids[i].price == last.bids[i].price && bids[i].quantity == last.bids[i].quantity);
+    }
+    cout << "test_book_view passed!" << endl;
+}
+
+// A generated feed replays into a book that ends exactly where the generating book did
+void test_mbo_feed_replay() {
+    const string path = "test_feed.bin";
+    MboGeneratorStats generated = generate_mbo_feed(path, 20000, 7);
+    assert(generated.records >= 20000 && generated.resting_orders > 0);
+
+    MboReader feed(path);
+    assert(feed.records().size() == generated.records);
+    size_t executes = 0;
+    for (const MboRecord& record : feed.records()) {
+        assert(record.order_id >= 1 && record.order_id <= feed.header().max_order_id);
+        executes += record.op == MboOp::execute;
+    }
+    assert(executes > 0);
+
+    Orderbook book(false, feed.ladder());
+    MboReplayStats stats = replay_mbo(feed, book);
+    assert(stats.messages == generated.records);
+    assert(stats.rejected == 0 && stats.mismatches == 0);
+    assert(book.order_pool_stats().in_use == generated.resting_orders);
+    assert(book.best_quote(BookSide::bid) == generated.best_bid);
+    assert(book.best_quote(BookSide::ask) == generated.best_ask);
+
+    // Ids beyond the header's range are refused rather than indexed
+    MboIdMap ids(4);
+    assert(ids.in_range(4) && !ids.in_range(5) && ids.get(5) == 0);
+
+    std::remove(path.c_str());
+    cout << "test_mbo_feed_replay passed!" << endl;
+}
+
 // Main function to run all tests
 int main() {
     test_add_order();
@@ -187,6 +1499,32 @@ int main() {
     test_best_quote();
     test_small_market_order_best_ask();
     test_modify_and_delete_order();
+    test_tick_normalization();
+    test_fixed_point_prices();
+    test_best_level_tracking();
+    test_price_outside_ladder();
+    test_modify_delete_unknown_id();
+    test_cancel_preserves_fifo();
+    test_order_pool_recycles();
+    test_order_ids();
+    test_flat_id_map();
+    test_spsc_ring();
+    test_order_gateway();
+    test_handle_orders_batch();
+    test_journal_replay();
+    test_snapshot_restore();
+    test_execution_events();
+    test_time_in_force();
+    test_iceberg_orders();
+    test_stop_orders();
+    test_pegged_orders();
+    test_self_trade_prevention();
+    test_risk_gate();
+    test_level_aggregates_and_l2();
+    test_book_view();
+    test_latency_histogram();
+    test_mbo_feed_replay();
+    test_matching_engine_routing();
 
     cout << "All tests passed!" << endl;
     return 0;